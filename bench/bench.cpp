@@ -0,0 +1,426 @@
+/* bench.cpp
+ * Synthetic workloads for the NFA, DPDA and TM simulators, and a driver that
+ * runs a simulator on them at growing sizes and reports how fast it went.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+using namespace std;
+
+// a generated description with its input. the work is what the throughput is
+// counted in: input symbols for the NFA and DPDA, which are known up front,
+// and steps for the TM, which are read back from the verdicts
+struct Workload {
+	string description;
+	string input;
+	unsigned long long symbols;
+};
+
+// the knobs of the generators
+struct Params {
+	int states;    // NFA states
+	int symbols;   // NFA alphabet size
+	int fanout;    // NFA targets per state and symbol
+	int kinds;     // kinds of brackets
+	int depth;     // deepest bracket nesting
+	int cases;     // cases per input
+	unsigned seed;
+};
+
+// join names with commas
+string joinNames(const vector<string> & names) {
+	string s;
+	for (unsigned i = 0; i < names.size(); ++i) { s += (i ? "," : "") + names[i]; }
+	return s;
+}
+
+// a random NFA: every state goes to a few random states on every symbol, one
+// in ten states has an empty string move, and one in four states accepts.
+// the input is random symbols, size of them per case
+Workload randomNFA(int size, const Params & p) {
+	mt19937 rng(p.seed);
+	vector<string> states, alphabet, accept;
+	for (int i = 0; i < p.states; ++i) { states.push_back("q" + to_string(i)); }
+	for (int i = 0; i < p.symbols; ++i) { alphabet.push_back("x" + to_string(i)); }
+	ostringstream d;
+	d << "A:" << joinNames(alphabet) << "\nQ:" << joinNames(states) << "\n";
+	for (int s = 0; s < p.states; ++s) {
+		for (int a = 0; a < p.symbols; ++a) {
+			for (int k = 0; k < p.fanout; ++k) { d << "T:" << states[s] << "," << alphabet[a] << "," << states[rng() % p.states] << "\n"; }
+		}
+		if (rng() % 10 == 0) { d << "T:" << states[s] << ",e," << states[rng() % p.states] << "\n"; }
+		if (rng() % 4 == 0) { accept.push_back(states[s]); }
+	}
+	d << "S:" << states[0] << "\nF:" << joinNames(accept) << "\n";
+
+	Workload w;
+	w.description = d.str();
+	ostringstream in;
+	in << p.cases << "\n";
+	for (int c = 0; c < p.cases; ++c) {
+		for (int i = 0; i < size; ++i) { in << (i ? "," : "") << alphabet[rng() % p.symbols]; }
+		in << "\n";
+	}
+	w.input = in.str();
+	w.symbols = (unsigned long long)size * p.cases;
+	return w;
+}
+
+// a DPDA for balanced brackets of several kinds. state b means only the
+// bottom marker is on the stack, and accepts; q is inside some brackets; c
+// has just closed one and looks at what is below it. the input is random
+// balanced brackets, nested no deeper than the depth asked for
+Workload bracketDPDA(int size, const Params & p) {
+	const char* opens = "([{<";
+	const char* closes = ")]}>";
+	int kinds = max(1, min(p.kinds, 4));
+	vector<string> inputs, stack;
+	stack.push_back("$");
+	for (int k = 0; k < kinds; ++k) {
+		inputs.push_back(string(1, opens[k]));
+		inputs.push_back(string(1, closes[k]));
+		stack.push_back("X" + to_string(k));
+	}
+	ostringstream d;
+	d << "Q:s,b,q,c\nA:" << joinNames(inputs) << "\nZ:" << joinNames(stack) << "\n";
+	d << "T:s,e,e,b,$\n";
+	for (int k = 0; k < kinds; ++k) {
+		d << "T:b," << opens[k] << ",e,q,X" << k << "\n";
+		d << "T:q," << opens[k] << ",e,q,X" << k << "\n";
+		d << "T:q," << closes[k] << ",X" << k << ",c,e\n";
+		d << "T:c,e,X" << k << ",q,X" << k << "\n";
+	}
+	d << "T:c,e,$,b,$\nS:s\nF:b\n";
+
+	Workload w;
+	w.description = d.str();
+	mt19937 rng(p.seed);
+	int length = size - size % 2;
+	ostringstream in;
+	in << p.cases << "\n";
+	vector<int> open;
+	for (int c = 0; c < p.cases; ++c) {
+		open.clear();
+		for (int i = 0; i < length; ++i) {
+			int left = length - i;
+			bool close = !open.empty() && ((int)open.size() == p.depth || (int)open.size() == left || rng() % 2);
+			if (i) { in << ","; }
+			if (close) {
+				in << closes[open.back()];
+				open.pop_back();
+			} else {
+				open.push_back(rng() % kinds);
+				in << opens[open.back()];
+			}
+		}
+		in << "\n";
+	}
+	w.input = in.str();
+	w.symbols = (unsigned long long)length * p.cases;
+	return w;
+}
+
+// a TM that counts in binary on the cells after a # until they are all ones:
+// size bits take about 2^size increments
+Workload counterTM(int size, const Params & p) {
+	Workload w;
+	w.description =
+		"Q:r,inc,acc,rej\nA:#,0,1\nZ:#,0,1, \n"
+		"T:r,0,r,0,R\nT:r,1,r,1,R\nT:r,#,r,#,R\nT:r, ,inc, ,L\n"
+		"T:inc,1,inc,0,L\nT:inc,0,r,1,R\nT:inc,#,acc,#,R\n"
+		"S:r\nF:acc,rej\n";
+	ostringstream in;
+	in << p.cases << "\n";
+	for (int c = 0; c < p.cases; ++c) {
+		in << "#";
+		for (int i = 0; i < size; ++i) { in << ",0"; }
+		in << "\n";
+	}
+	w.input = in.str();
+	w.symbols = 0;
+	return w;
+}
+
+// a TM that copies a random word of size bits after a #, one marked bit at a
+// time, so it takes about 2 * size^2 steps
+Workload copierTM(int size, const Params & p) {
+	Workload w;
+	w.description =
+		"Q:init,back,pick,carry0,carry1,acc,rej\nA:$,0,1\nZ:$,0,1,#,X,Y, \n"
+		"T:init,$,init,$,R\nT:init,0,init,0,R\nT:init,1,init,1,R\nT:init, ,back,#,L\n"
+		"T:back,0,back,0,L\nT:back,1,back,1,L\nT:back,#,back,#,L\nT:back,X,pick,X,R\nT:back,Y,pick,Y,R\nT:back,$,pick,$,R\n"
+		"T:pick,0,carry0,X,R\nT:pick,1,carry1,Y,R\nT:pick,#,acc,#,R\n"
+		"T:carry0,0,carry0,0,R\nT:carry0,1,carry0,1,R\nT:carry0,#,carry0,#,R\nT:carry0, ,back,0,L\n"
+		"T:carry1,0,carry1,0,R\nT:carry1,1,carry1,1,R\nT:carry1,#,carry1,#,R\nT:carry1, ,back,1,L\n"
+		"S:init\nF:acc,rej\n";
+	mt19937 rng(p.seed);
+	ostringstream in;
+	in << p.cases << "\n";
+	for (int c = 0; c < p.cases; ++c) {
+		in << "$";
+		for (int i = 0; i < size; ++i) { in << "," << (char)('0' + rng() % 2); }
+		in << "\n";
+	}
+	w.input = in.str();
+	w.symbols = 0;
+	return w;
+}
+
+// the busy beaver champion with size states (2 to 5) on blank tape. they
+// need a tape that is unbounded on the left too. the 5-state one takes
+// 47,176,870 steps
+Workload beaverTM(int size, const Params & p) {
+	// the transitions of each state on a blank and on a 1: what to write, where to go and the next state
+	static const char* tables[] = {
+		"1RB 1LB 1LA 1RH",
+		"1RB 1RH 0RC 1RB 1LC 1LA",
+		"1RB 1LB 1LA 0LC 1RH 1LD 1RD 0RA",
+		"1RB 1LC 1RC 1RB 1RD 0LE 1LA 1LD 1RH 0LA",
+	};
+	int n = max(2, min(size, 5));
+	istringstream table(tables[n - 2]);
+	ostringstream d;
+	d << "Q:";
+	for (int s = 0; s < n; ++s) { d << (char)('A' + s) << ","; }
+	d << "H,R\nA:1\nZ:1, \n";
+	string move;
+	for (int i = 0; table >> move; ++i) {
+		char write = (move[0] == '1') ? '1' : ' ';
+		d << "T:" << (char)('A' + i / 2) << "," << ((i % 2) ? '1' : ' ') << "," << move[2] << "," << write << "," << move[1] << "\n";
+	}
+	d << "S:A\nF:H,R\n";
+
+	Workload w;
+	w.description = d.str();
+	ostringstream in;
+	in << p.cases << "\n";
+	for (int c = 0; c < p.cases; ++c) { in << "\n"; }
+	w.input = in.str();
+	w.symbols = 0;
+	return w;
+}
+
+// the workloads by name, and the model each one is for
+struct Generator {
+	const char* name;
+	const char* model;
+	Workload (*generate)(int size, const Params & p);
+};
+
+const Generator GENERATORS[] = {
+	{ "nfa-random", "nfa", randomNFA },
+	{ "dpda-brackets", "dpda", bracketDPDA },
+	{ "tm-counter", "tm", counterTM },
+	{ "tm-copier", "tm", copierTM },
+	{ "tm-beaver", "tm", beaverTM },
+};
+const int NUM_GENERATORS = sizeof(GENERATORS) / sizeof(GENERATORS[0]);
+
+const Generator* findGenerator(const string & name) {
+	for (int i = 0; i < NUM_GENERATORS; ++i) {
+		if (name == GENERATORS[i].name) { return &GENERATORS[i]; }
+	}
+	return NULL;
+}
+
+// write a string to a file, quitting if it cannot be written
+void writeFile(const string & path, const string & text) {
+	ofstream out(path.c_str(), ios::binary);
+	out << text;
+	if (!out) {
+		cout << "Could not write " << path << endl;
+		exit(1);
+	}
+}
+
+// what one run of a simulator came to
+struct Measurement {
+	double seconds;
+	long peakKilobytes;
+	int status;
+	unsigned long long steps; // summed from the verdicts
+};
+
+// run a command with its input and output redirected to files, timing it and
+// taking its peak memory from the kernel
+Measurement measure(const vector<string> & command, const string & inPath, const string & outPath) {
+	vector<char*> args;
+	for (unsigned i = 0; i < command.size(); ++i) { args.push_back(const_cast<char*>(command[i].c_str())); }
+	args.push_back(NULL);
+
+	Measurement m = { 0, 0, -1, 0 };
+	chrono::steady_clock::time_point before = chrono::steady_clock::now();
+	pid_t pid = fork();
+	if (pid == 0) {
+		int in = open(inPath.c_str(), O_RDONLY);
+		int out = open(outPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		int null = open("/dev/null", O_WRONLY);
+		if (in < 0 || out < 0 || null < 0) { _exit(127); }
+		dup2(in, 0);
+		dup2(out, 1);
+		dup2(null, 2);
+		execv(args[0], &args[0]);
+		_exit(127);
+	}
+	int status = 0;
+	struct rusage usage;
+	if (pid < 0 || wait4(pid, &status, 0, &usage) < 0) { return m; }
+	m.seconds = chrono::duration<double>(chrono::steady_clock::now() - before).count();
+	m.peakKilobytes = usage.ru_maxrss;
+	m.status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+
+	// the verdicts are printed with --steps, so each line ends with its count
+	ifstream out(outPath.c_str());
+	string line;
+	while (getline(out, line)) {
+		size_t space = line.rfind(' ');
+		if (space != string::npos) { m.steps += strtoull(line.c_str() + space + 1, NULL, 10); }
+	}
+	return m;
+}
+
+// one entry of the plan: a workload at some sizes, run with some options
+struct Benchmark {
+	const char* workload;
+	const char* options; // space separated
+	vector<int> sizes;
+	vector<int> quickSizes;
+};
+
+// what is run for each model. the set engine of the NFA simulator is the
+// slow reference, so it only gets the small inputs
+vector<Benchmark> plan(const string & model) {
+	vector<Benchmark> b;
+	if (model == "nfa") {
+		b.push_back({ "nfa-random", "--engine=bitset", { 1000, 10000, 100000 }, { 1000, 10000 } });
+		b.push_back({ "nfa-random", "--engine=dfa", { 1000, 10000, 100000 }, { 1000, 10000 } });
+		b.push_back({ "nfa-random", "--engine=lanes", { 1000, 10000, 100000 }, { 1000, 10000 } });
+		b.push_back({ "nfa-random", "--engine=set", { 1000, 10000 }, { 1000 } });
+	} else if (model == "dpda") {
+		b.push_back({ "dpda-brackets", "", { 1000, 10000, 100000, 1000000 }, { 1000, 10000 } });
+		b.push_back({ "dpda-brackets", "--threads=0", { 1000, 10000, 100000, 1000000 }, { 1000, 10000 } });
+	} else if (model == "tm") {
+		b.push_back({ "tm-counter", "--max-steps=0", { 12, 16, 20 }, { 12, 14 } });
+		b.push_back({ "tm-counter", "--max-steps=0 --macro=4", { 12, 16, 20 }, { 12, 14 } });
+		b.push_back({ "tm-copier", "--max-steps=0", { 250, 500, 1000, 2000 }, { 250, 500 } });
+		b.push_back({ "tm-copier", "--max-steps=0 --macro=4", { 250, 500, 1000, 2000 }, { 250, 500 } });
+		b.push_back({ "tm-beaver", "--max-steps=0 --two-way", { 4, 5 }, { 4 } });
+	}
+	return b;
+}
+
+// print the usage message and quit
+void usage() {
+	cout << "usage: ./bench run nfa|dpda|tm [--quick] [--seed=<n>] [--cases=<n>] <simulator> [<arguments>...] > <results.json>" << endl;
+	cout << "       ./bench gen <workload> <size> <prefix> [--seed=<n>] [--cases=<n>] [--states=<n>] [--symbols=<n>] [--fanout=<n>] [--kinds=<n>] [--depth=<n>]" << endl;
+	cout << "workloads:";
+	for (int i = 0; i < NUM_GENERATORS; ++i) { cout << " " << GENERATORS[i].name; }
+	cout << endl;
+	exit(1);
+}
+
+int main(int argc, char** argv) {
+	if (argc < 3) { usage(); }
+	string command = argv[1];
+	Params params = { 64, 4, 2, 2, 32, 16, 1 };
+	bool quick = false;
+	vector<string> positional;
+	int i = 2;
+	for (; i < argc; ++i) {
+		string arg = argv[i];
+		if (arg == "--quick") {
+			quick = true;
+		} else if (arg.compare(0, 7, "--seed=") == 0) {
+			params.seed = strtoul(arg.c_str() + 7, NULL, 10);
+		} else if (arg.compare(0, 8, "--cases=") == 0) {
+			params.cases = atoi(arg.c_str() + 8);
+		} else if (arg.compare(0, 9, "--states=") == 0) {
+			params.states = atoi(arg.c_str() + 9);
+		} else if (arg.compare(0, 10, "--symbols=") == 0) {
+			params.symbols = atoi(arg.c_str() + 10);
+		} else if (arg.compare(0, 9, "--fanout=") == 0) {
+			params.fanout = atoi(arg.c_str() + 9);
+		} else if (arg.compare(0, 8, "--kinds=") == 0) {
+			params.kinds = atoi(arg.c_str() + 8);
+		} else if (arg.compare(0, 8, "--depth=") == 0) {
+			params.depth = atoi(arg.c_str() + 8);
+		} else if (arg[0] == '-') {
+			usage();
+		} else {
+			positional.push_back(arg);
+			// everything after the simulator is its own command line
+			if (command == "run" && positional.size() == 2) { break; }
+		}
+	}
+	if (params.states <= 0 || params.symbols <= 0 || params.fanout <= 0 || params.depth <= 0 || params.cases <= 0) { usage(); }
+
+	// write a single workload out for use elsewhere
+	if (command == "gen") {
+		if (positional.size() != 3 || !findGenerator(positional[0])) { usage(); }
+		Workload w = findGenerator(positional[0])->generate(atoi(positional[1].c_str()), params);
+		writeFile(positional[2] + ".txt", w.description);
+		writeFile(positional[2] + ".in", w.input);
+		return 0;
+	}
+	if (command != "run" || positional.size() != 2) { usage(); }
+	string model = positional[0];
+	vector<string> simulator(argv + i, argv + argc);
+	vector<Benchmark> benchmarks = plan(model);
+	if (benchmarks.empty()) { usage(); }
+
+	char dir[] = "/tmp/automata-bench-XXXXXX";
+	if (!mkdtemp(dir)) {
+		cout << "Could not make a scratch directory." << endl;
+		exit(1);
+	}
+	string description = string(dir) + "/workload.txt", input = string(dir) + "/workload.in", output = string(dir) + "/output";
+
+	// one JSON object per line on stdout, a readable table on stderr
+	bool failed = false;
+	for (unsigned b = 0; b < benchmarks.size(); ++b) {
+		const vector<int> & sizes = quick ? benchmarks[b].quickSizes : benchmarks[b].sizes;
+		for (unsigned s = 0; s < sizes.size(); ++s) {
+			Workload w = findGenerator(benchmarks[b].workload)->generate(sizes[s], params);
+			writeFile(description, w.description);
+			writeFile(input, w.input);
+
+			vector<string> command = simulator;
+			istringstream options(benchmarks[b].options);
+			string option;
+			while (options >> option) { command.push_back(option); }
+			command.push_back("--quiet");
+			command.push_back("--steps");
+			command.push_back(description);
+			Measurement m = measure(command, input, output);
+			failed = failed || m.status != 0;
+
+			const char* unit = (model == "tm") ? "steps" : "symbols";
+			unsigned long long work = (model == "tm") ? m.steps : w.symbols;
+			double rate = m.seconds > 0 ? work / m.seconds : 0;
+			cout << "{\"model\":\"" << model << "\",\"workload\":\"" << benchmarks[b].workload << "\",\"options\":\"" << benchmarks[b].options
+				 << "\",\"size\":" << sizes[s] << ",\"cases\":" << params.cases << ",\"unit\":\"" << unit << "\",\"work\":" << work
+				 << ",\"seconds\":" << m.seconds << ",\"per_second\":" << rate << ",\"peak_kb\":" << m.peakKilobytes
+				 << ",\"exit\":" << m.status << "}" << endl;
+			fprintf(stderr, "%-14s %-24s %8d %14llu %-7s %9.3f s %14.0f/s %9ld KB%s\n", benchmarks[b].workload, benchmarks[b].options,
+				sizes[s], work, unit, m.seconds, rate, m.peakKilobytes, m.status ? "  FAILED" : "");
+		}
+	}
+
+	unlink(description.c_str());
+	unlink(input.c_str());
+	unlink(output.c_str());
+	rmdir(dir);
+	return failed ? 1 : 0;
+}
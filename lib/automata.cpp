@@ -0,0 +1,447 @@
+/* automata.cpp
+ * Parts shared by the NFA, DPDA and TM simulators.
+ */
+
+#include "automata.h"
+
+#include <cctype>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// split a string into tokens by a delimiter, appending them to a vector. an
+// empty string has no tokens, otherwise there is one more token than delimiters
+static void appendTokens(const string & s, size_t from, char delim, vector<string> & v) {
+	if (from >= s.size()) { return; }
+	while (true) {
+		size_t ind = s.find(delim, from);
+		if (ind == string::npos) { break; }
+		v.push_back(s.substr(from, ind - from));
+		from = ind + 1;
+	}
+	v.push_back(s.substr(from));
+}
+
+vector<string> splitStringByDelimiter(const string & s, char delim) {
+	vector<string> v;
+	appendTokens(s, 0, delim, v);
+	return v;
+}
+
+bool readSection(const string & line, char tag, vector<string> & fields) {
+	fields.clear();
+	if (line.size() < 2 || line[0] != tag || line[1] != ':') { return false; }
+	appendTokens(line, 2, ',', fields);
+	return true;
+}
+
+DescriptionReader::DescriptionReader(const char* path, Split split) : split(split), readable(false), pos(0) {
+	FILE* in = fopen(path, "rb");
+	if (!in) { return; }
+	char buffer[1 << 16];
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0) { text.append(buffer, n); }
+	readable = !ferror(in);
+	fclose(in);
+}
+
+bool DescriptionReader::next(string & line) {
+	line.clear();
+	if (split == WORDS) {
+		while (pos < text.size() && isspace((unsigned char)text[pos])) { ++pos; }
+		if (pos == text.size()) { return false; }
+		size_t from = pos;
+		while (pos < text.size() && !isspace((unsigned char)text[pos])) { ++pos; }
+		line.assign(text, from, pos - from);
+		return true;
+	}
+	if (pos == text.size()) { return false; }
+	size_t ind = text.find('\n', pos);
+	if (ind == string::npos) { ind = text.size(); }
+	line.assign(text, pos, ind - pos);
+	pos = min(ind + 1, text.size());
+	return true;
+}
+
+// an image starts with the magic bytes, its version and a marker that tells
+// the byte order, then the name of its model
+static const char IMAGE_MAGIC[8] = { 'A', 'U', 'T', 'O', 'M', 'A', 'T', 'A' };
+static const unsigned IMAGE_VERSION = 1;
+static const unsigned IMAGE_BYTE_ORDER = 0x01020304;
+
+ImageWriter::ImageWriter(const string & model) {
+	putBytes(IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+	put(IMAGE_VERSION);
+	put(IMAGE_BYTE_ORDER);
+	putArray(model.data(), model.size());
+}
+
+void ImageWriter::putBytes(const void* data, size_t n) {
+	bytes.append((const char*)data, n);
+	bytes.append((8 - bytes.size() % 8) % 8, '\0');
+}
+
+void ImageWriter::putStrings(const vector<string> & strings) {
+	put((unsigned long long)strings.size());
+	for (unsigned i = 0; i < strings.size(); ++i) { putArray(strings[i].data(), strings[i].size()); }
+}
+
+void ImageWriter::putNames(const SymbolTable & table) {
+	vector<string> names(table.size());
+	for (int i = 0; i < table.size(); ++i) { names[i] = table.name(i); }
+	putStrings(names);
+}
+
+void ImageWriter::putFlags(const vector<bool> & flags) {
+	vector<char> bytes(flags.begin(), flags.end());
+	putArray(bytes.data(), bytes.size());
+}
+
+void ImageWriter::save(const char* path) const {
+	FILE* out = fopen(path, "wb");
+	if (!out || fwrite(bytes.data(), 1, bytes.size(), out) != bytes.size() || fclose(out) != 0) {
+		cout << "Could not write the compiled automaton: " << path << endl;
+		exit(1);
+	}
+}
+
+ImageReader::~ImageReader() {
+	if (base) { munmap((void*)base, size); }
+}
+
+bool ImageReader::open(const char* file, const string & model) {
+	int fd = ::open(file, O_RDONLY);
+	if (fd < 0) { return false; }
+	char magic[sizeof(IMAGE_MAGIC)];
+	struct stat info;
+	if (read(fd, magic, sizeof(magic)) != (ssize_t)sizeof(magic) || memcmp(magic, IMAGE_MAGIC, sizeof(magic)) != 0 || fstat(fd, &info) != 0) {
+		close(fd);
+		return false;
+	}
+	path = file;
+	size = info.st_size;
+	void* mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED) { corrupt(); }
+	base = (const char*)mapped;
+
+	pos = sizeof(IMAGE_MAGIC);
+	unsigned version = get<unsigned>(), byteOrder = get<unsigned>();
+	if (version != IMAGE_VERSION || byteOrder != IMAGE_BYTE_ORDER) {
+		cout << "The compiled automaton " << path << " was written by another version or on another kind of machine, compile it again." << endl;
+		exit(1);
+	}
+	unsigned long long length = get<unsigned long long>();
+	string name(take(length), length);
+	if (name != model) {
+		cout << "The compiled automaton " << path << " was compiled for " << name << ", not for " << model << "." << endl;
+		exit(1);
+	}
+	return true;
+}
+
+const char* ImageReader::take(size_t n) {
+	size_t padded = (n + 7) / 8 * 8;
+	if (padded < n || padded > size - pos) { corrupt(); }
+	const char* p = base + pos;
+	pos += padded;
+	return p;
+}
+
+vector<string> ImageReader::getStrings() {
+	unsigned long long n = get<unsigned long long>();
+	if (n > size) { corrupt(); }
+	vector<string> strings(n);
+	for (unsigned long long i = 0; i < n; ++i) {
+		unsigned long long length = get<unsigned long long>();
+		strings[i].assign(take(length), length);
+	}
+	return strings;
+}
+
+void ImageReader::getNames(SymbolTable & table) {
+	vector<string> names = getStrings();
+	for (unsigned i = 0; i < names.size(); ++i) {
+		if (table.intern(names[i]) != (int)i) { corrupt(); }
+	}
+}
+
+vector<bool> ImageReader::getFlags(size_t expected) {
+	const char* bytes = getArray<char>(expected);
+	return vector<bool>(bytes, bytes + expected);
+}
+
+void ImageReader::corrupt() const {
+	cout << "Invalid compiled automaton: " << path << endl;
+	exit(1);
+}
+
+void printVerdict(ostream & out, const OutputMode & mode, const char* verdict, unsigned long long steps) {
+	out << verdict;
+	if (mode.stepCount) { out << " " << steps; }
+	out << '\n';
+}
+
+void Profile::add(const Profile & other) {
+	cases += other.cases;
+	steps += other.steps;
+	epsilonMoves += other.epsilonMoves;
+	lookups += other.lookups;
+	peakStates = max(peakStates, other.peakStates);
+	peakStack = max(peakStack, other.peakStack);
+	peakCells = max(peakCells, other.peakCells);
+	caseMillis += other.caseMillis;
+	inputMillis += other.inputMillis;
+	outputMillis += other.outputMillis;
+}
+
+void writeProfile(const string & path, const Profile & profile, const string & model, const string & engine, int numThreads,
+	double loadMillis, double wallMillis) {
+	ostringstream json;
+	json << "{\"model\":\"" << model << "\",\"engine\":\"" << engine << "\",\"threads\":" << numThreads
+		 << ",\"cases\":" << profile.cases << ",\"steps\":" << profile.steps << ",\"epsilon_moves\":" << profile.epsilonMoves
+		 << ",\"lookups\":" << profile.lookups << ",\"peak_states\":" << profile.peakStates << ",\"peak_stack\":" << profile.peakStack
+		 << ",\"peak_cells\":" << profile.peakCells << ",\"load_ms\":" << loadMillis << ",\"input_ms\":" << profile.inputMillis
+		 << ",\"simulate_ms\":" << max(0.0, profile.caseMillis - profile.inputMillis - profile.outputMillis)
+		 << ",\"output_ms\":" << profile.outputMillis << ",\"wall_ms\":" << wallMillis << "}\n";
+	cout.flush();
+	if (path.empty()) {
+		cerr << json.str();
+		return;
+	}
+	ofstream out(path.c_str());
+	out << json.str();
+	if (!out) {
+		cout << "Could not write the profile: " << path << endl;
+		exit(1);
+	}
+}
+
+int parseThreadCount(const char* s) {
+	int n = atoi(s);
+	if (n <= 0) { n = thread::hardware_concurrency(); }
+	return (n <= 0) ? 1 : n;
+}
+
+unsigned long long parseSize(const string & s) {
+	char* rest;
+	unsigned long long n = strtoull(s.c_str(), &rest, 10);
+	if (rest == s.c_str()) { return 0; }
+	string suffix = rest;
+	if (suffix == "k" || suffix == "K") { return n << 10; }
+	if (suffix == "m" || suffix == "M") { return n << 20; }
+	if (suffix == "g" || suffix == "G") { return n << 30; }
+	return suffix.empty() ? n : 0;
+}
+
+bool cutLinePiece(SymbolReader & input, size_t size, string & carry, string & piece) {
+	piece.swap(carry);
+	carry.clear();
+	size_t cut = string::npos;
+	bool ended = false;
+	while (!ended && cut == string::npos) {
+		ended = input.readLinePart(piece, size);
+		cut = piece.rfind(',');
+	}
+	if (!ended) {
+		carry.assign(piece, cut + 1, string::npos);
+		piece.resize(cut);
+	}
+	return ended;
+}
+
+void lookUpPiece(const string & piece, bool whole, const SymbolTable & table, vector<int> & ids, string & unknown) {
+	ids.clear();
+	SymbolReader input(piece);
+	string symbol;
+	bool more = piece.empty() ? !whole : input.next(symbol);
+	while (more) {
+		ids.push_back(table.find(symbol));
+		if (ids.back() < 0) {
+			unknown = symbol;
+			return;
+		}
+		more = input.next(symbol);
+	}
+}
+
+string cppLiteral(const string & s) {
+	string res = "\"";
+	for (unsigned i = 0; i < s.size(); ++i) {
+		unsigned char c = s[i];
+		if (c == '"' || c == '\\') {
+			res += '\\';
+			res += c;
+		} else if (c < 32 || c >= 127) {
+			// three octal digits always, so that a digit after it is not taken in
+			char escape[5];
+			snprintf(escape, sizeof(escape), "\\%03o", c);
+			res += escape;
+		} else {
+			res += c;
+		}
+	}
+	return res + "\"";
+}
+
+void emitNames(ostream & out, const char* array, const vector<string> & names) {
+	out << "static const char* const " << array << "[] = {";
+	for (unsigned i = 0; i < names.size(); ++i) { out << (i ? ", " : " ") << cppLiteral(names[i]); }
+	out << (names.empty() ? " \"\" };\n" : " };\n");
+}
+
+void emitLookup(ostream & out, const char* function, const vector<string> & names, const vector<int> & ids) {
+	vector<pair<size_t, unsigned> > byLength;
+	for (unsigned i = 0; i < names.size(); ++i) { byLength.push_back(make_pair(names[i].size(), i)); }
+	sort(byLength.begin(), byLength.end());
+	out << "static int " << function << "(const string & s) {\n";
+	out << "\tswitch (s.size()) {\n";
+	for (unsigned i = 0; i < byLength.size(); ++i) {
+		size_t length = byLength[i].first;
+		const string & name = names[byLength[i].second];
+		if (!i || length != byLength[i - 1].first) { out << "\tcase " << length << ":\n"; }
+		if (length) {
+			out << "\t\tif (memcmp(s.data(), " << cppLiteral(name) << ", " << length << ") == 0) { return " << ids[byLength[i].second] << "; }\n";
+		} else {
+			out << "\t\treturn " << ids[byLength[i].second] << ";\n";
+		}
+		if (i + 1 == byLength.size() || byLength[i + 1].first != length) { out << "\t\tbreak;\n"; }
+	}
+	out << "\t}\n\treturn -1;\n}\n";
+}
+
+void bufferOutput() {
+	static char outputBuffer[1 << 20];
+	ios::sync_with_stdio(false);
+	cout.rdbuf()->pubsetbuf(outputBuffer, sizeof(outputBuffer));
+}
+
+// run the cases of the input on a pool of threads and print their outputs in
+// input order. every thread has a deque of cases of its own: it takes the
+// oldest case from its own deque and, once that is empty, steals the newest
+// from another thread's, so a run of slow cases does not leave the other
+// threads idle. cases are read ahead into a window, and each one is printed as
+// soon as the cases before it are, so a slow case holds up the printing but
+// not the work on the cases after it
+static bool runCasesInParallel(SymbolReader & reader, int numOfCases, int numThreads, bool separate,
+	const function<bool(int, SymbolReader &, ostream &)> & runCase) {
+	const int WINDOW = 4096;
+	int window = min(numOfCases, WINDOW);
+	if (window <= 0) { return true; }
+	vector<string> lines(window), outputs(window);
+	vector<char> done(window, false), valid(window, true);
+	vector<deque<int> > queues(numThreads);
+	vector<mutex> queueLocks(numThreads);
+	mutex lock; // guards done, pending and finished
+	condition_variable workReady, caseDone;
+	int pending = 0;
+	bool finished = false;
+
+	auto take = [&](int t) {
+		for (int k = 0; k < numThreads; ++k) {
+			int victim = (t + k) % numThreads;
+			lock_guard<mutex> guard(queueLocks[victim]);
+			if (queues[victim].empty()) { continue; }
+			int i;
+			if (k == 0) {
+				i = queues[victim].front();
+				queues[victim].pop_front();
+			} else {
+				i = queues[victim].back();
+				queues[victim].pop_back();
+			}
+			return i;
+		}
+		return -1;
+	};
+
+	vector<thread> workers;
+	for (int t = 0; t < numThreads; ++t) {
+		workers.push_back(thread([&, t]() {
+			ostringstream out;
+			while (true) {
+				int i = take(t);
+				if (i < 0) {
+					unique_lock<mutex> guard(lock);
+					if (finished) { return; }
+					workReady.wait(guard, [&]() { return pending > 0 || finished; });
+					continue;
+				}
+				{
+					lock_guard<mutex> guard(lock);
+					--pending;
+				}
+				out.str("");
+				SymbolReader input(lines[i % window]);
+				valid[i % window] = runCase(t, input, out);
+				outputs[i % window] = out.str();
+				{
+					lock_guard<mutex> guard(lock);
+					done[i % window] = true;
+				}
+				caseDone.notify_one();
+			}
+		}));
+	}
+
+	int read = 0;
+	bool goOn = true;
+	for (int printed = 0; printed < numOfCases && goOn; ++printed) {
+		// top the window up; the slot of a printed case is free again
+		for (; read < numOfCases && read - printed < window; ++read) {
+			reader.readLine(lines[read % window]);
+			{
+				lock_guard<mutex> guard(lock);
+				done[read % window] = false;
+			}
+			{
+				lock_guard<mutex> guard(queueLocks[read % numThreads]);
+				queues[read % numThreads].push_back(read);
+			}
+			{
+				lock_guard<mutex> guard(lock);
+				++pending;
+			}
+			workReady.notify_one();
+		}
+		unique_lock<mutex> guard(lock);
+		caseDone.wait(guard, [&]() { return done[printed % window] != 0; });
+		guard.unlock();
+		if (printed && separate) { cout << '\n'; }
+		cout << outputs[printed % window];
+		goOn = valid[printed % window];
+	}
+
+	// when stopping early, the cases nobody has started on are dropped
+	for (int t = 0; t < numThreads; ++t) {
+		lock_guard<mutex> guard(queueLocks[t]);
+		queues[t].clear();
+	}
+	{
+		lock_guard<mutex> guard(lock);
+		finished = true;
+	}
+	workReady.notify_all();
+	for (int t = 0; t < numThreads; ++t) { workers[t].join(); }
+	return goOn;
+}
+
+bool runCases(SymbolReader & reader, int numThreads, bool separate,
+	const function<bool(int, SymbolReader &, ostream &)> & runCase) {
+	int numOfCases = reader.readCount();
+	if (numThreads > 1) { return runCasesInParallel(reader, numOfCases, numThreads, separate, runCase); }
+	for (int i = 0; i < numOfCases; ++i) {
+		if (i && separate) { cout << '\n'; }
+		reader.beginLine();
+		if (!runCase(0, reader, cout)) { return false; }
+	}
+	return true;
+}
@@ -0,0 +1,433 @@
+/* automata.h
+ * Parts shared by the NFA, DPDA and TM simulators: reading descriptions and
+ * inputs, interning symbols, and running the cases of an input.
+ */
+
+#ifndef AUTOMATA_H
+#define AUTOMATA_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// check if an item is in a container
+template <typename T>
+bool isInList(const T & x, const vector<T> & l) {
+	return (find(l.begin(), l.end(), x) != l.end());
+}
+
+template <typename T>
+bool isInList(const T & x, const set<T> & l) {
+	return l.count(x) != 0;
+}
+
+// split a string into tokens by a delimiter and store them in a vector
+vector<string> splitStringByDelimiter(const string & s, char delim);
+
+// check that a line of a description has a tag such as "Q:" and split what
+// follows it on commas, false when the line has another tag
+bool readSection(const string & line, char tag, vector<string> & fields);
+
+// a description file read into memory in one go and handed out a line at a
+// time. the NFA and DPDA descriptions are read a word at a time, as the >>
+// operator would, the TM description whole lines at a time since its
+// alphabets may contain the blank
+class DescriptionReader {
+public:
+	enum Split { WORDS, LINES };
+
+	DescriptionReader(const char* path, Split split);
+
+	// whether the file could be read
+	bool good() const { return readable; }
+
+	// read the next line into line, or leave it empty and return false at the end of the file
+	bool next(string & line);
+
+private:
+	Split split;
+	bool readable;
+	string text;
+	size_t pos;
+};
+
+// hands out the comma separated symbols of the input one line at a time. stdin
+// is read through a fixed size buffer, so a case is never held in memory as a
+// whole and every byte is looked at once, however long the line is
+class SymbolReader {
+public:
+	// read from a stream, refilling the buffer as it drains
+	explicit SymbolReader(FILE* in) : in(in), storage(1 << 20), data(NULL), pos(0), len(0), lineDone(true), started(false) {}
+	// read from a line that is already in memory
+	explicit SymbolReader(const string & line) : in(NULL), data(line.data()), pos(0), len(line.size()), lineDone(false), started(false) {}
+
+	// read the number of cases, discarding the rest of its line
+	int readCount() {
+		int n = 0;
+		int c = peek();
+		while (c == ' ' || c == '\t' || c == '\r' || c == '\n') { ++pos; c = peek(); }
+		bool negative = (c == '-');
+		if (c == '-' || c == '+') { ++pos; c = peek(); }
+		while (c >= '0' && c <= '9') { n = n * 10 + (c - '0'); ++pos; c = peek(); }
+		string rest;
+		readLine(rest);
+		return negative ? -n : n;
+	}
+
+	// read a whole line, without its newline
+	bool readLine(string & line) {
+		line.clear();
+		if (peek() == EOF) { return false; }
+		appendUntil(line, '\n', '\n');
+		return true;
+	}
+
+	// start on the symbols of the next line
+	void beginLine() { lineDone = started = false; }
+
+	// read the next symbol of the current line, false once the line is used up.
+	// as with splitting the line on commas, an empty line has no symbols at all
+	bool next(string & symbol) {
+		if (lineDone) { return false; }
+		if (!started) {
+			started = true;
+			int c = peek();
+			if (c == EOF || c == '\n') {
+				if (c == '\n') { ++pos; }
+				lineDone = true;
+				return false;
+			}
+		}
+		symbol.clear();
+		lineDone = (appendUntil(symbol, ',', '\n') != ',');
+		return true;
+	}
+
+	// append up to max bytes of what is left of the current line to part, as
+	// they are, without its newline. true once the line has ended
+	bool readLinePart(string & part, size_t max) {
+		started = true;
+		while (!lineDone) {
+			if (pos == len && !refill()) {
+				lineDone = true;
+				break;
+			}
+			if (max == 0) { return false; }
+			size_t n = min(len - pos, max);
+			const char* newline = (const char*)memchr(data + pos, '\n', n);
+			if (newline) { n = newline - (data + pos); }
+			part.append(data + pos, n);
+			pos += n;
+			max -= n;
+			if (newline) {
+				++pos;
+				lineDone = true;
+			}
+		}
+		return true;
+	}
+
+	// whether the symbol just read was the last one of its line
+	bool lineEnded() const { return lineDone; }
+
+	// throw away whatever is left of the current line
+	void skipLine() {
+		string rest;
+		while (next(rest)) {}
+	}
+
+private:
+	FILE* in;
+	vector<char> storage;
+	const char* data;
+	size_t pos, len;
+	bool lineDone, started;
+
+	int peek() {
+		if (pos == len && !refill()) { return EOF; }
+		return (unsigned char)data[pos];
+	}
+
+	bool refill() {
+		if (!in) { return false; }
+		len = fread(&storage[0], 1, storage.size(), in);
+		data = &storage[0];
+		pos = 0;
+		return len > 0;
+	}
+
+	// append bytes up to either stop byte or the end of the input, consuming and
+	// returning the stop byte that was met, or EOF
+	int appendUntil(string & s, char stop1, char stop2) {
+		while (pos < len || refill()) {
+			const char* p = data + pos;
+			const char* e = data + len;
+			const char* q = p;
+			while (q < e && *q != stop1 && *q != stop2) { ++q; }
+			s.append(p, q - p);
+			pos = q - data;
+			if (q < e) {
+				++pos;
+				return *q;
+			}
+		}
+		return EOF;
+	}
+};
+
+// interns strings to dense integer ids
+class SymbolTable {
+public:
+	SymbolTable() {}
+	// intern a list of names in order
+	explicit SymbolTable(const vector<string> & names) {
+		for (unsigned i = 0; i < names.size(); ++i) { intern(names[i]); }
+	}
+
+	int intern(const string & s) {
+		unordered_map<string, int>::const_iterator it = ids.find(s);
+		if (it != ids.end()) { return it->second; }
+		ids[s] = names.size();
+		names.push_back(s);
+		return names.size() - 1;
+	}
+	int find(const string & s) const {
+		unordered_map<string, int>::const_iterator it = ids.find(s);
+		return (it == ids.end()) ? -1 : it->second;
+	}
+	bool contains(const string & s) const { return ids.count(s) != 0; }
+	const string & name(int id) const { return names[id]; }
+	int size() const { return names.size(); }
+private:
+	unordered_map<string, int> ids;
+	vector<string> names;
+};
+
+// a flat array of plain values that either holds them itself or, once loaded
+// from an image, points at them inside the mapped file and is only read
+template <typename T>
+class FlatArray {
+public:
+	FlatArray() : ptr(NULL), count(0) {}
+	FlatArray(const FlatArray & other) { *this = other; }
+	FlatArray & operator=(const FlatArray & other) {
+		owned = other.owned;
+		ptr = owned.empty() ? other.ptr : &owned[0];
+		count = other.count;
+		return *this;
+	}
+
+	void assign(size_t n, const T & value) {
+		owned.assign(n, value);
+		ptr = owned.empty() ? NULL : &owned[0];
+		count = n;
+	}
+	// take over the contents of a vector, leaving it empty
+	void adopt(vector<T> & values) {
+		owned.clear();
+		owned.swap(values);
+		ptr = owned.empty() ? NULL : &owned[0];
+		count = owned.size();
+	}
+	// use values that live somewhere else, such as in a mapped image
+	void view(const T* values, size_t n) {
+		owned.clear();
+		ptr = const_cast<T*>(values);
+		count = n;
+	}
+
+	T & operator[](size_t i) { return ptr[i]; }
+	const T & operator[](size_t i) const { return ptr[i]; }
+	T* begin() { return ptr; }
+	const T* begin() const { return ptr; }
+	const T* end() const { return ptr + count; }
+	size_t size() const { return count; }
+
+private:
+	vector<T> owned;
+	T* ptr;
+	size_t count;
+};
+
+// builds the compiled form of an automaton as it is saved to a file: a header
+// naming the model, then a run of values and arrays, each padded to a multiple
+// of 8 bytes so that the arrays can be used in place once the file is mapped
+// into memory. an image is only meant for the kind of machine that wrote it
+class ImageWriter {
+public:
+	explicit ImageWriter(const string & model);
+
+	template <typename T>
+	void put(const T & value) { putBytes(&value, sizeof(T)); }
+	template <typename T>
+	void putArray(const T* values, size_t n) {
+		put((unsigned long long)n);
+		putBytes(values, n * sizeof(T));
+	}
+	void putStrings(const vector<string> & strings);
+	void putNames(const SymbolTable & table);
+	// flags such as vector<bool> go in as one byte each
+	void putFlags(const vector<bool> & flags);
+
+	// write the image out, quitting if it cannot be written
+	void save(const char* path) const;
+
+private:
+	string bytes;
+	void putBytes(const void* data, size_t n);
+};
+
+// a compiled automaton mapped into memory, read back in the order it was written
+class ImageReader {
+public:
+	ImageReader() : base(NULL), size(0), pos(0) {}
+	~ImageReader();
+
+	// map the file if it is an image, false when it is not (it may still be a
+	// text description). an image of another version, or one of another model,
+	// is reported and quits
+	bool open(const char* path, const string & model);
+
+	template <typename T>
+	T get() {
+		T value;
+		memcpy(&value, take(sizeof(T)), sizeof(T));
+		return value;
+	}
+	// an array inside the image, used where it is. its length must be the expected one
+	template <typename T>
+	const T* getArray(size_t expected) {
+		if (get<unsigned long long>() != expected) { corrupt(); }
+		return (const T*)take(expected * sizeof(T));
+	}
+	template <typename T>
+	void getArray(FlatArray<T> & array, size_t expected) { array.view(getArray<T>(expected), expected); }
+	// the same for an array of any length
+	template <typename T>
+	void getArray(FlatArray<T> & array) {
+		unsigned long long n = get<unsigned long long>();
+		if (n > size / sizeof(T)) { corrupt(); }
+		array.view((const T*)take(n * sizeof(T)), n);
+	}
+	vector<string> getStrings();
+	void getNames(SymbolTable & table);
+	vector<bool> getFlags(size_t expected);
+
+	// report an image that does not hold what it should and quit
+	void corrupt() const;
+
+private:
+	const char* base;
+	size_t size, pos;
+	string path;
+	const char* take(size_t n);
+};
+
+// what gets written for each case
+struct OutputMode {
+	bool trace;                    // print the run as it goes
+	bool stepCount;                // follow the verdict with the number of steps taken
+	unsigned long long traceEvery; // TM only: print the configuration before every n-th step, 0 for only the last one
+};
+
+// print the verdict of a case, the last line of its output
+void printVerdict(ostream & out, const OutputMode & mode, const char* verdict, unsigned long long steps);
+
+// counters and timings of a batch of cases, kept when --profile asks for them.
+// every thread keeps its own and they are added up at the end. a counter that
+// does not apply to a model stays 0
+struct Profile {
+	unsigned long long cases;
+	unsigned long long steps;        // transitions taken, or symbols read by the NFA
+	unsigned long long epsilonMoves; // empty string transitions followed
+	unsigned long long lookups;      // transition table lookups
+	unsigned long long peakStates;   // NFA: most states active at once
+	unsigned long long peakStack;    // DPDA: deepest the stack got
+	unsigned long long peakCells;    // TM: most tape cells the head went over in one case
+	double caseMillis;               // spent in the cases, of which
+	double inputMillis;              // reading input ahead of a run
+	double outputMillis;             // printing traces
+
+	Profile() : cases(0), steps(0), epsilonMoves(0), lookups(0), peakStates(0), peakStack(0), peakCells(0),
+		caseMillis(0), inputMillis(0), outputMillis(0) {}
+
+	// add another thread's counters to these
+	void add(const Profile & other);
+};
+
+// adds the time from its making to its end to a total, and does nothing at all
+// when there is no total, so that it can sit in the hot paths unconditionally
+class ProfileTimer {
+public:
+	explicit ProfileTimer(double* total) : total(total) {
+		if (total) { start = chrono::steady_clock::now(); }
+	}
+	~ProfileTimer() {
+		if (total) { *total += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count(); }
+	}
+private:
+	double* total;
+	chrono::steady_clock::time_point start;
+};
+
+// write the profile of a run as one JSON object to a file, or to stderr when
+// the path is empty. loadMillis is the time spent getting the automaton ready,
+// wallMillis the time of the whole run
+void writeProfile(const string & path, const Profile & profile, const string & model, const string & engine, int numThreads,
+	double loadMillis, double wallMillis);
+
+// the number of threads asked for by --threads=<n>, all of the cores for 0
+int parseThreadCount(const char* s);
+
+// a byte count with an optional k, m or g suffix, or zero when malformed
+unsigned long long parseSize(const string & s);
+
+// cut the next piece off the current line, for a case that is split across
+// threads: read about size bytes and end the piece at its last comma, carrying
+// the start of the symbol after it over to the next piece. a symbol longer
+// than size is read on until it ends. true once the line has ended
+bool cutLinePiece(SymbolReader & input, size_t size, string & carry, string & piece);
+
+// look up the symbols of a piece cut off with cutLinePiece, as SymbolReader
+// would read them. every piece has at least one symbol, if only an empty one,
+// except the whole of an empty line. stops after the first symbol not in the
+// table, which is looked up as -1 and left in unknown
+void lookUpPiece(const string & piece, bool whole, const SymbolTable & table, vector<int> & ids, string & unknown);
+
+// a string as a C++ string literal, for the sources written by --emit-cpp
+string cppLiteral(const string & s);
+
+// write the names of a machine's states or symbols as a C++ array of string
+// literals, so that a generated simulator can print them
+void emitNames(ostream & out, const char* array, const vector<string> & names);
+
+// write a C++ function that looks a symbol up by its name, returning ids[i]
+// for names[i] and -1 for any other name. the names are told apart by their
+// length and then compared whole, so the lookup needs no table at run time
+void emitLookup(ostream & out, const char* function, const vector<string> & names, const vector<int> & ids);
+
+// send cout through one large buffer instead of flushing it line by line
+void bufferOutput();
+
+// read the number of cases and run each one, printing their outputs in input
+// order and separated by blank lines if asked to. a single thread streams
+// every case straight from the reader, several work through the cases
+// together. runCase is given the thread it runs on, and returns false to stop
+// after its own output, in which case so does runCases
+bool runCases(SymbolReader & reader, int numThreads, bool separate,
+	const function<bool(int, SymbolReader &, ostream &)> & runCase);
+
+// the simulators, each taking the command line that follows the model name
+namespace nfaEngine { int run(int argc, char** argv); }
+namespace dpdaEngine { int run(int argc, char** argv); }
+namespace tmEngine { int run(int argc, char** argv); }
+
+#endif
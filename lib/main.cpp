@@ -0,0 +1,38 @@
+/* main.cpp
+ * One binary for all of the simulators: the first argument picks the model,
+ * the rest are handed to its simulator as they are.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "automata.h"
+using namespace std;
+
+// print the usage message and quit
+void usage() {
+	cout << "usage: ./automata nfa|dpda|tm [<options>] <description|image> < <input> > <output>" << endl;
+	cout << "       ./automata compile nfa|dpda|tm <description> <image>" << endl;
+	exit(1);
+}
+
+// hand the arguments that follow the model name to its simulator
+int runModel(const string & model, int argc, char** argv) {
+	if (model == "nfa") { return nfaEngine::run(argc, argv); }
+	if (model == "dpda") { return dpdaEngine::run(argc, argv); }
+	if (model == "tm") { return tmEngine::run(argc, argv); }
+	usage();
+	return 1;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) { usage(); }
+	string model = argv[1];
+	if (model != "compile") { return runModel(model, argc - 1, argv + 1); }
+
+	// checking and compiling a description once is the same as running it with --compile
+	if (argc != 5) { usage(); }
+	string option = string("--compile=") + argv[4];
+	char* args[] = { argv[2], &option[0], argv[3], NULL };
+	return runModel(argv[2], 3, args);
+}
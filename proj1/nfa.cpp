@@ -4,52 +4,37 @@
  *     Date: Sunday, February 8, 2015
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <map>
 #include <set>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
+#include "automata.h"
 using namespace std;
 
-// check if an item is in the vector
-template <typename T>
-bool isInList(const T x, vector<T> l) {
-	return (find(l.begin(), l.end(), x) != l.end());
-}
-
-template <typename T>
-bool isInList(const T x, set<T> l) {
-	return (find(l.begin(), l.end(), x) != l.end());
-}
+namespace nfaEngine {
 
 // check if a transition is valid
-bool isTransitionValid(vector<string> t, vector<string> alpha, vector<string> states) {
-	return (isInList(t[0], states) && (t[1] == "e" || isInList(t[1], alpha)) && isInList(t[2], states));
-}
-
-// split a string into tokens by a delimiter and store them in a vector
-vector<string> splitStringByDelimiter(string s, char delim) {
-	vector<string> v;
-	if (!s.size()) { return v; }
-	unsigned long long ind = s.find(delim);
-	while (ind < s.size()) {
-		v.push_back(s.substr(0, ind));
-		s = s.substr(ind + 1);
-		ind = s.find(delim);
-	}
-	v.push_back(s);
-	return v;
+bool isTransitionValid(const vector<string> & t, const SymbolTable & alpha, const SymbolTable & states) {
+	return (t.size() >= 3 && states.contains(t[0]) && (t[1] == "e" || alpha.contains(t[1])) && states.contains(t[2]));
 }
 
 // get all the possible states that can be reached from here
-set<string> reachable_from_here(set<string> here, string input, map<pair<string, string>, vector<string> > transitions) {
+set<string> reachable_from_here(const set<string> & here, const string & input, const map<pair<string, string>, vector<string> > & transitions) {
 	set<string> next;
 	for (set<string>::const_iterator it = here.begin(); it != here.end(); ++it) {
-		if (transitions.count(make_pair(*it, input))) {
-			vector<string> reachables = transitions[make_pair(*it, input)];
-			for (int i = 0; i < reachables.size(); ++i) {
+		map<pair<string, string>, vector<string> >::const_iterator found = transitions.find(make_pair(*it, input));
+		if (found != transitions.end()) {
+			const vector<string> & reachables = found->second;
+			for (unsigned i = 0; i < reachables.size(); ++i) {
 				next.insert(reachables[i]);
 			}
 		}
@@ -58,13 +43,13 @@ set<string> reachable_from_here(set<string> here, string input, map<pair<string,
 }
 
 // count number of duplicates between two sets
-int duplicatesOfTwoSets(set<string> a, set<string> b) {
+size_t duplicatesOfTwoSets(set<string> a, set<string> b) {
 	if (a.size() < b.size()) {
 		set<string> t = a;
 		a = b;
 		b = t;
 	}
-	int initialSize = a.size();
+	size_t initialSize = a.size();
 	for (set<string>::const_iterator it = b.begin(); it != b.end(); ++it) {
 		a.insert(*it);
 	}	
@@ -90,125 +75,1488 @@ string printSetByDelim(set<string> s, char delim) {
 	return res;
 }
 
-// meat of the NFA analyses
-void analyzeNFA(vector<string> alphabet, vector<string> states, map<pair<string, string>, vector<string> > transitions, string start, vector<string> end, vector<string> input) {
+// follow the empty string transitions out of a set of states until nothing new
+// is reached, counting the lookups and the states that were added when profiling
+void closeReachable(set<string> & reachable_so_far, const map<pair<string, string>, vector<string> > & transitions, Profile* profile) {
+	size_t before = reachable_so_far.size();
+	if (profile) { profile->lookups += reachable_so_far.size(); }
+	set<string> new_reachable = reachable_from_here(reachable_so_far, "e", transitions);
+	while (duplicatesOfTwoSets(new_reachable, reachable_so_far) < new_reachable.size()) {
+		reachable_so_far = mergeTwoSets(new_reachable, reachable_so_far);
+		if (profile) { profile->lookups += reachable_so_far.size(); }
+		new_reachable = reachable_from_here(reachable_so_far, "e", transitions);
+	}
+	if (profile) { profile->epsilonMoves += reachable_so_far.size() - before; }
+}
+
+// meat of the NFA analyses, false when the input has a symbol outside the alphabet
+bool analyzeNFA(const vector<string> & alphabet, const map<pair<string, string>, vector<string> > & transitions, const string & start,
+	const vector<string> & end, const vector<string> & input, ostream & out, const OutputMode & mode, Profile* profile) {
 	set<string> reachable_so_far; // all the states that can be reached by the input so far
 	reachable_so_far.insert(start);
-	cout << "; " << start << endl;
-	for (int i = 0; i < input.size(); ++i) {
+	if (mode.trace) { out << "; " << start << '\n'; }
+	for (size_t i = 0; i < input.size(); ++i) {
 		if (!isInList(input[i], alphabet)) {
-			cout << "Invalid input: " << input[i] << endl;
-			exit(1);
+			out << "Invalid input: " << input[i] << '\n';
+			return false;
 		}
 		// deal with empty string input 
-		set<string> new_reachable = reachable_from_here(reachable_so_far, "e", transitions);
-		while (duplicatesOfTwoSets(new_reachable, reachable_so_far) < new_reachable.size()) {
-			reachable_so_far = mergeTwoSets(new_reachable, reachable_so_far);
-			new_reachable = reachable_from_here(reachable_so_far, "e", transitions);
-		}
+		closeReachable(reachable_so_far, transitions, profile);
 		// deal with the real string input
-		new_reachable = reachable_from_here(reachable_so_far, input[i], transitions);
-		reachable_so_far = new_reachable;
+		if (profile) { profile->lookups += reachable_so_far.size(); }
+		reachable_so_far = reachable_from_here(reachable_so_far, input[i], transitions);
 		// deal with empty string again
-		new_reachable = reachable_from_here(reachable_so_far, "e", transitions);
-		while (duplicatesOfTwoSets(new_reachable, reachable_so_far) < new_reachable.size()) {
-			reachable_so_far = mergeTwoSets(new_reachable, reachable_so_far);
-			new_reachable = reachable_from_here(reachable_so_far, "e", transitions);
+		closeReachable(reachable_so_far, transitions, profile);
+		if (profile) {
+			++profile->steps;
+			profile->peakStates = max(profile->peakStates, (unsigned long long)reachable_so_far.size());
+		}
+		if (mode.trace) {
+			ProfileTimer timer(profile ? &profile->outputMillis : NULL);
+			out << input[i] << "; " << printSetByDelim(reachable_so_far, ',') << '\n';
 		}
-		cout << input[i] << "; " << printSetByDelim(reachable_so_far, ',') << endl; 
 	}
-	for (int i = 0; i < end.size(); ++i) {
+	for (size_t i = 0; i < end.size(); ++i) {
 		if (isInList(end[i], reachable_so_far)) {
-			cout << "ACCEPT" << endl;
-			return;
+			printVerdict(out, mode, "ACCEPT", input.size());
+			return true;
 		} 
 	}
-	cout << "REJECT" << endl;
+	printVerdict(out, mode, "REJECT", input.size());
+	return true;
 }
 
-// main program
-int main(int argc, char** argv) {
-	// check if there is one and exactly one parameter
-	if (argc != 2) {
-		cout << "usage: ./nfa <nfa_description> < <input> > <output>" << endl;
-		exit(1);
-    }
+// a set of states is a bitset stored in 64-bit words, bit i standing for state i
+typedef unsigned long long Word;
+const int WORD_BITS = 64;
+
+// the NFA with states and symbols interned to integers. state ids follow the
+// sorted order of the state names so that walking a bitset from low to high
+// bits lists the states in the same order as a set<string> would
+struct CompiledNFA {
+	vector<string> states;   // state names indexed by state id
+	SymbolTable symbols;     // transition symbols, "e" is always symbol 0
+	vector<bool> inAlphabet; // whether a symbol may appear in the input
+	int numWords;            // number of words in one state set
+	int start;
+	FlatArray<Word> closure; // empty string closure mask of a state at state * numWords
+	FlatArray<Word> succ;    // closed successor mask of (state, symbol) at (state * symbols.size() + symbol) * numWords
+	vector<Word> accept;     // mask of the accepted states
+	double closureMillis;    // time spent computing the closures at load time
+
+	const Word* closureOf(int state) const { return &closure[(unsigned long long)state * numWords]; }
+	Word* successors(int state, int symbol) {
+		return &succ[((unsigned long long)state * symbols.size() + symbol) * numWords];
+	}
+	const Word* successors(int state, int symbol) const {
+		return &succ[((unsigned long long)state * symbols.size() + symbol) * numWords];
+	}
+};
+
+// compute the empty string closure of every state, then fold the closures into
+// the successor masks so that stepping a closed set keeps it closed. the closures
+// come from the strongly connected components of the "e" edges: tarjan's
+// algorithm finishes a component only after every component it reaches, so each
+// closure is the union of its own members and the already finished closures
+void computeClosures(CompiledNFA & nfa) {
+	int n = nfa.states.size(), W = nfa.numWords;
+	nfa.closure.assign((unsigned long long)n * W, 0);
+	vector<vector<int> > edges(n);
+	for (int s = 0; s < n; ++s) {
+		const Word* mask = nfa.successors(s, 0);
+		for (int w = 0; w < W; ++w) {
+			for (Word bits = mask[w]; bits; bits &= bits - 1) { edges[s].push_back(w * WORD_BITS + __builtin_ctzll(bits)); }
+		}
+	}
+
+	// iterative tarjan, since epsilon chains may be far deeper than the call stack
+	vector<int> index(n, -1), low(n, 0), component(n, -1), position(n, 0), members;
+	vector<bool> onStack(n, false);
+	vector<pair<int, unsigned> > calls;
+	int counter = 0, components = 0;
+	for (int root = 0; root < n; ++root) {
+		if (index[root] >= 0) { continue; }
+		calls.push_back(make_pair(root, 0u));
+		while (!calls.empty()) {
+			int s = calls.back().first;
+			unsigned & next = calls.back().second;
+			if (next == 0) {
+				index[s] = low[s] = counter++;
+				position[s] = members.size();
+				members.push_back(s);
+				onStack[s] = true;
+			}
+			if (next < edges[s].size()) {
+				int t = edges[s][next++];
+				if (index[t] < 0) {
+					calls.push_back(make_pair(t, 0u));
+				} else if (onStack[t]) {
+					low[s] = min(low[s], index[t]);
+				}
+				continue;
+			}
+			calls.pop_back();
+			if (!calls.empty()) { low[calls.back().first] = min(low[calls.back().first], low[s]); }
+			if (low[s] != index[s]) { continue; }
+
+			// s is the root of a finished component: build its closure once and share it
+			vector<Word> mask(W, 0);
+			unsigned first = position[s];
+			for (unsigned i = first; i < members.size(); ++i) {
+				int m = members[i];
+				mask[m / WORD_BITS] |= 1ULL << (m % WORD_BITS);
+				for (unsigned j = 0; j < edges[m].size(); ++j) {
+					int t = edges[m][j];
+					if (component[t] < 0) { continue; }
+					const Word* other = nfa.closureOf(t);
+					for (int w = 0; w < W; ++w) { mask[w] |= other[w]; }
+				}
+			}
+			for (unsigned i = first; i < members.size(); ++i) {
+				onStack[members[i]] = false;
+				component[members[i]] = components;
+				copy(mask.begin(), mask.end(), nfa.closure.begin() + (unsigned long long)members[i] * W);
+			}
+			members.resize(first);
+			++components;
+		}
+	}
+
+	// successor masks now lead straight to closed sets
+	vector<Word> closed(W);
+	for (int s = 0; s < n; ++s) {
+		for (int a = 0; a < nfa.symbols.size(); ++a) {
+			Word* mask = nfa.successors(s, a);
+			fill(closed.begin(), closed.end(), 0);
+			for (int w = 0; w < W; ++w) {
+				for (Word bits = mask[w]; bits; bits &= bits - 1) {
+					const Word* other = nfa.closureOf(w * WORD_BITS + __builtin_ctzll(bits));
+					for (int i = 0; i < W; ++i) { closed[i] |= other[i]; }
+				}
+			}
+			copy(closed.begin(), closed.end(), mask);
+		}
+	}
+}
+
+// intern the states and symbols of a parsed description and build its successor masks
+void compileNFA(CompiledNFA & nfa, const vector<string> & alphabet, const vector<string> & states,
+	const map<pair<string, string>, vector<string> > & transitions, const string & start, const vector<string> & end) {
+	nfa.states = states;
+	sort(nfa.states.begin(), nfa.states.end());
+	nfa.states.erase(unique(nfa.states.begin(), nfa.states.end()), nfa.states.end());
+	map<string, int> stateIds;
+	for (unsigned i = 0; i < nfa.states.size(); ++i) { stateIds[nfa.states[i]] = i; }
+
+	nfa.symbols.intern("e");
+	for (unsigned i = 0; i < alphabet.size(); ++i) { nfa.symbols.intern(alphabet[i]); }
+	nfa.inAlphabet.assign(nfa.symbols.size(), false);
+	for (unsigned i = 0; i < alphabet.size(); ++i) { nfa.inAlphabet[nfa.symbols.find(alphabet[i])] = true; }
+
+	nfa.numWords = (nfa.states.size() + WORD_BITS - 1) / WORD_BITS;
+	nfa.start = stateIds[start];
+	nfa.succ.assign(nfa.states.size() * nfa.symbols.size() * nfa.numWords, 0);
+	for (map<pair<string, string>, vector<string> >::const_iterator it = transitions.begin(); it != transitions.end(); ++it) {
+		Word* mask = nfa.successors(stateIds[it->first.first], nfa.symbols.find(it->first.second));
+		for (unsigned i = 0; i < it->second.size(); ++i) {
+			int target = stateIds[it->second[i]];
+			mask[target / WORD_BITS] |= 1ULL << (target % WORD_BITS);
+		}
+	}
+	nfa.accept.assign(nfa.numWords, 0);
+	for (unsigned i = 0; i < end.size(); ++i) {
+		int state = stateIds[end[i]];
+		nfa.accept[state / WORD_BITS] |= 1ULL << (state % WORD_BITS);
+	}
+
+	chrono::steady_clock::time_point before = chrono::steady_clock::now();
+	computeClosures(nfa);
+	nfa.closureMillis = chrono::duration<double, milli>(chrono::steady_clock::now() - before).count();
+}
+
+// or the closed successor masks of every state in "here" on a symbol into "next"
+void stepStateSet(const CompiledNFA & nfa, const Word* here, int symbol, Word* next) {
+	fill(next, next + nfa.numWords, 0);
+	for (int w = 0; w < nfa.numWords; ++w) {
+		for (Word bits = here[w]; bits; bits &= bits - 1) {
+			const Word* mask = nfa.successors(w * WORD_BITS + __builtin_ctzll(bits), symbol);
+			for (int i = 0; i < nfa.numWords; ++i) { next[i] |= mask[i]; }
+		}
+	}
+}
+
+// extend a state set with everything reachable through empty string transitions
+void closeStateSet(const CompiledNFA & nfa, vector<Word> & here) {
+	vector<Word> closed(here);
+	for (int w = 0; w < nfa.numWords; ++w) {
+		for (Word bits = here[w]; bits; bits &= bits - 1) {
+			const Word* mask = nfa.closureOf(w * WORD_BITS + __builtin_ctzll(bits));
+			for (int i = 0; i < nfa.numWords; ++i) { closed[i] |= mask[i]; }
+		}
+	}
+	here.swap(closed);
+}
+
+// print a state set with a specified delimiter
+string printStateSetByDelim(const CompiledNFA & nfa, const Word* s, char delim) {
+	bool isFirstCase = true;
+	string res = "";
+	for (int w = 0; w < nfa.numWords; ++w) {
+		for (Word bits = s[w]; bits; bits &= bits - 1) {
+			if (isFirstCase) { isFirstCase = false; } else { res += delim; }
+			res += nfa.states[w * WORD_BITS + __builtin_ctzll(bits)];
+		}
+	}
+	return res;
+}
+
+// the number of states in a state set
+unsigned long long countStates(const CompiledNFA & nfa, const Word* s) {
+	unsigned long long n = 0;
+	for (int w = 0; w < nfa.numWords; ++w) { n += __builtin_popcountll(s[w]); }
+	return n;
+}
+
+// same analyses as analyzeNFA, but over the compiled NFA. its successor masks
+// already include the empty string closures, so the only epsilon moves counted
+// are the ones that close the start set
+bool analyzeCompiledNFA(const CompiledNFA & nfa, SymbolReader & input, ostream & out, const OutputMode & mode, Profile* profile) {
+	vector<Word> reachable_so_far(nfa.numWords, 0), scratch(nfa.numWords);
+	reachable_so_far[nfa.start / WORD_BITS] |= 1ULL << (nfa.start % WORD_BITS);
+	if (mode.trace) { out << "; " << nfa.states[nfa.start] << '\n'; }
+	string text;
+	unsigned long long steps = 0;
+	while (input.next(text)) {
+		int symbol = nfa.symbols.find(text);
+		if (symbol < 0 || !nfa.inAlphabet[symbol]) {
+			out << "Invalid input: " << text << '\n';
+			return false;
+		}
+		// only the start set can be open, every step lands on a closed set
+		if (steps++ == 0) {
+			closeStateSet(nfa, reachable_so_far);
+			if (profile) { profile->epsilonMoves += countStates(nfa, &reachable_so_far[0]) - 1; }
+		}
+		if (profile) { profile->lookups += countStates(nfa, &reachable_so_far[0]); }
+		stepStateSet(nfa, &reachable_so_far[0], symbol, &scratch[0]);
+		reachable_so_far.swap(scratch);
+		if (profile) { profile->peakStates = max(profile->peakStates, countStates(nfa, &reachable_so_far[0])); }
+		if (mode.trace) {
+			ProfileTimer timer(profile ? &profile->outputMillis : NULL);
+			out << text << "; " << printStateSetByDelim(nfa, &reachable_so_far[0], ',') << '\n';
+		}
+	}
+	if (profile) { profile->steps += steps; }
+	for (int i = 0; i < nfa.numWords; ++i) {
+		if (reachable_so_far[i] & nfa.accept[i]) {
+			printVerdict(out, mode, "ACCEPT", steps);
+			return true;
+		}
+	}
+	printVerdict(out, mode, "REJECT", steps);
+	return true;
+}
+
+// the NFA determinized on demand. every closed state set met while simulating
+// becomes a DFA state with a transition row that is filled in as symbols are
+// seen, so repeated inputs turn into table lookups. when the cache outgrows its
+// memory limit it is flushed; a flush that happens before the cache paid for
+// itself asks the caller to go back to plain bitset simulation for the case
+class LazyDFA {
+public:
+	enum { UNKNOWN = -1 };
+
+	unsigned long long hits, misses, flushes, fallbacks;
+
+	LazyDFA(const CompiledNFA & nfa, unsigned long long memoryLimit)
+		: hits(0), misses(0), flushes(0), fallbacks(0), nfa(nfa), memoryLimit(memoryLimit), memoryUsed(0),
+		  hitsSinceFlush(0), missesSinceFlush(0), wastefulFlush(false), startState(UNKNOWN), scratch(nfa.numWords) {
+		// a state costs its set, its row, and the set again as the index key
+		bytesPerState = 2 * nfa.numWords * sizeof(Word) + nfa.symbols.size() * sizeof(int) + 64;
+	}
+
+	// the DFA state of the closure of the start state
+	int start() {
+		if (startState == UNKNOWN) {
+			fill(scratch.begin(), scratch.end(), 0);
+			const Word* mask = nfa.closureOf(nfa.start);
+			copy(mask, mask + nfa.numWords, scratch.begin());
+			startState = add(&scratch[0]);
+		}
+		return startState;
+	}
+
+	// follow a transition, determinizing its target on a miss
+	int next(int state, int symbol) {
+		unsigned long long row = (unsigned long long)state * nfa.symbols.size() + symbol;
+		if (rows[row] != UNKNOWN) {
+			++hits;
+			++hitsSinceFlush;
+			return rows[row];
+		}
+		++misses;
+		++missesSinceFlush;
+		stepStateSet(nfa, setOf(state), symbol, &scratch[0]);
+		int target = find(&scratch[0]);
+		if (target == UNKNOWN) {
+			if (memoryUsed + bytesPerState > memoryLimit) {
+				flush();
+				return add(&scratch[0]);
+			}
+			target = add(&scratch[0]);
+		}
+		return rows[row] = target;
+	}
+
+	// whether the last flush came too soon for the cache to be worth keeping
+	bool shouldFallBack() {
+		bool res = wastefulFlush;
+		wastefulFlush = false;
+		if (res) { ++fallbacks; }
+		return res;
+	}
+
+	const Word* setOf(int state) const { return &sets[(unsigned long long)state * nfa.numWords]; }
+	bool accepts(int state) const { return accepting[state]; }
+	int size() const { return accepting.size(); }
+
+private:
+	const CompiledNFA & nfa;
+	unsigned long long memoryLimit, memoryUsed, bytesPerState;
+	unsigned long long hitsSinceFlush, missesSinceFlush;
+	bool wastefulFlush;
+	int startState;
+	vector<Word> sets;     // state sets, numWords words each
+	vector<int> rows;      // transition rows, symbols.size() entries each
+	vector<bool> accepting;
+	unordered_map<string, int> index;
+	vector<Word> scratch;
+
+	string keyOf(const Word* set) const { return string((const char*)set, nfa.numWords * sizeof(Word)); }
+
+	int find(const Word* set) const {
+		unordered_map<string, int>::const_iterator it = index.find(keyOf(set));
+		return (it == index.end()) ? UNKNOWN : it->second;
+	}
+
+	int add(const Word* set) {
+		int id = accepting.size();
+		sets.insert(sets.end(), set, set + nfa.numWords);
+		rows.resize(rows.size() + nfa.symbols.size(), UNKNOWN);
+		bool accepted = false;
+		for (int i = 0; i < nfa.numWords; ++i) { accepted |= (set[i] & nfa.accept[i]) != 0; }
+		accepting.push_back(accepted);
+		index[keyOf(set)] = id;
+		memoryUsed += bytesPerState;
+		return id;
+	}
+
+	// a flush is wasteful when the cache served fewer than ten lookups per state it built
+	void flush() {
+		++flushes;
+		wastefulFlush = hitsSinceFlush < 10 * missesSinceFlush;
+		hitsSinceFlush = missesSinceFlush = 0;
+		sets.clear();
+		rows.clear();
+		accepting.clear();
+		index.clear();
+		memoryUsed = 0;
+		startState = UNKNOWN;
+	}
+};
+
+// same analyses as analyzeCompiledNFA, but stepping through the lazy DFA. a
+// lookup is one row of the DFA, or one state's mask after falling back
+bool analyzeLazyDFA(LazyDFA & dfa, const CompiledNFA & nfa, SymbolReader & input, ostream & out, const OutputMode & mode, Profile* profile) {
+	if (mode.trace) { out << "; " << nfa.states[nfa.start] << '\n'; }
+	int state = LazyDFA::UNKNOWN;
+	vector<Word> reachable_so_far, scratch; // only used after falling back to the bitset engine
+	string text;
+	unsigned long long steps = 0;
+	while (input.next(text)) {
+		int symbol = nfa.symbols.find(text);
+		if (symbol < 0 || !nfa.inAlphabet[symbol]) {
+			out << "Invalid input: " << text << '\n';
+			return false;
+		}
+		if (!reachable_so_far.empty()) {
+			if (profile) { profile->lookups += countStates(nfa, &reachable_so_far[0]); }
+			stepStateSet(nfa, &reachable_so_far[0], symbol, &scratch[0]);
+			reachable_so_far.swap(scratch);
+			++steps;
+			if (profile) { profile->peakStates = max(profile->peakStates, countStates(nfa, &reachable_so_far[0])); }
+			if (mode.trace) {
+				ProfileTimer timer(profile ? &profile->outputMillis : NULL);
+				out << text << "; " << printStateSetByDelim(nfa, &reachable_so_far[0], ',') << '\n';
+			}
+			continue;
+		}
+		state = dfa.next((steps++ == 0) ? dfa.start() : state, symbol);
+		if (profile) {
+			++profile->lookups;
+			profile->peakStates = max(profile->peakStates, countStates(nfa, dfa.setOf(state)));
+		}
+		if (mode.trace) {
+			ProfileTimer timer(profile ? &profile->outputMillis : NULL);
+			out << text << "; " << printStateSetByDelim(nfa, dfa.setOf(state), ',') << '\n';
+		}
+		if (dfa.shouldFallBack()) {
+			reachable_so_far.assign(dfa.setOf(state), dfa.setOf(state) + nfa.numWords);
+			scratch.resize(nfa.numWords);
+		}
+	}
+	if (profile) { profile->steps += steps; }
+	bool accepted;
+	if (!reachable_so_far.empty()) {
+		accepted = false;
+		for (int i = 0; i < nfa.numWords; ++i) { accepted |= (reachable_so_far[i] & nfa.accept[i]) != 0; }
+	} else if (state == LazyDFA::UNKNOWN) {
+		accepted = (nfa.accept[nfa.start / WORD_BITS] >> (nfa.start % WORD_BITS)) & 1;
+	} else {
+		accepted = dfa.accepts(state);
+	}
+	printVerdict(out, mode, accepted ? "ACCEPT" : "REJECT", steps);
+	return true;
+}
+
+// one bit per case for a batch of cases stepped together. gcc turns the
+// operations on it into SSE or AVX instructions, whichever the target has
+typedef unsigned long long Lanes __attribute__((vector_size(32)));
+const int LANES = 256;
+
+bool anyLane(const Lanes & l) {
+	return (l[0] | l[1] | l[2] | l[3]) != 0;
+}
+
+void setLane(Lanes & l, int lane) {
+	l[lane / WORD_BITS] |= 1ULL << (lane % WORD_BITS);
+}
+
+bool hasLane(const Lanes & l, int lane) {
+	return (l[lane / WORD_BITS] >> (lane % WORD_BITS)) & 1;
+}
+
+// same verdicts as analyzeCompiledNFA for a batch of up to LANES cases at
+// once. the state sets are kept the other way around: for every NFA state, the
+// lanes of the cases that are in it. each input position is one step for the
+// whole batch, which goes through every active state and every symbol that
+// some case has at that position, and a case that has run out of input keeps
+// its states. only verdicts are printed, false after a case with a symbol
+// outside the alphabet. the symbols of the cases go into inputs, which is kept
+// from one batch to the next
+bool analyzeLanes(const CompiledNFA & nfa, const vector<string> & lines, vector<vector<int> > & inputs, ostream & out,
+	const OutputMode & mode, Profile* profile) {
+	int n = nfa.states.size(), numCases = lines.size();
+	vector<string> invalid(numCases);
+	size_t longest = 0;
+	Lanes all = {};
+	string text;
+	for (int c = 0; c < numCases; ++c) {
+		inputs[c].clear();
+		SymbolReader input(lines[c]);
+		while (input.next(text)) {
+			int symbol = nfa.symbols.find(text);
+			if (symbol < 0 || !nfa.inAlphabet[symbol]) {
+				invalid[c] = text;
+				inputs[c].clear();
+				break;
+			}
+			inputs[c].push_back(symbol);
+		}
+		longest = max(longest, inputs[c].size());
+		setLane(all, c);
+	}
+
+	// every case starts out in the closure of the start state
+	vector<Lanes> active(n), next(n), byMask(nfa.symbols.size());
+	const Word* start = nfa.closureOf(nfa.start);
+	for (int w = 0; w < nfa.numWords; ++w) {
+		for (Word bits = start[w]; bits; bits &= bits - 1) { active[w * WORD_BITS + __builtin_ctzll(bits)] = all; }
+	}
+	vector<int> used;
+	for (size_t i = 0; i < longest; ++i) {
+		// the lanes that read each symbol at this position, and the ones that are done
+		Lanes done = {};
+		for (int c = 0; c < numCases; ++c) {
+			if (i >= inputs[c].size()) {
+				setLane(done, c);
+				continue;
+			}
+			int symbol = inputs[c][i];
+			if (!anyLane(byMask[symbol])) { used.push_back(symbol); }
+			setLane(byMask[symbol], c);
+		}
+
+		bool anyDone = anyLane(done);
+		for (int s = 0; s < n; ++s) { next[s] = anyDone ? (active[s] & done) : Lanes{}; }
+		for (int s = 0; s < n; ++s) {
+			if (!anyLane(active[s])) { continue; }
+			for (unsigned u = 0; u < used.size(); ++u) {
+				Lanes m = active[s] & byMask[used[u]];
+				if (!anyLane(m)) { continue; }
+				const Word* mask = nfa.successors(s, used[u]);
+				for (int w = 0; w < nfa.numWords; ++w) {
+					for (Word bits = mask[w]; bits; bits &= bits - 1) { next[w * WORD_BITS + __builtin_ctzll(bits)] |= m; }
+				}
+			}
+		}
+		active.swap(next);
+		for (unsigned u = 0; u < used.size(); ++u) { byMask[used[u]] = Lanes{}; }
+		used.clear();
+	}
+
+	// a case without input is decided by the start state alone, like everywhere else
+	Lanes accepted = {};
+	for (int s = 0; s < n; ++s) {
+		if ((nfa.accept[s / WORD_BITS] >> (s % WORD_BITS)) & 1) { accepted |= active[s]; }
+	}
+	bool startAccepts = (nfa.accept[nfa.start / WORD_BITS] >> (nfa.start % WORD_BITS)) & 1;
+	for (int c = 0; c < numCases; ++c) {
+		if (!invalid[c].empty()) {
+			out << "Invalid input: " << invalid[c] << '\n';
+			return false;
+		}
+		bool accepts = inputs[c].empty() ? startAccepts : hasLane(accepted, c);
+		printVerdict(out, mode, accepts ? "ACCEPT" : "REJECT", inputs[c].size());
+		if (profile) {
+			++profile->cases;
+			profile->steps += inputs[c].size();
+		}
+	}
+	return true;
+}
+
+// look for matches anywhere in the input instead of deciding it as a whole.
+// the closure of the start state is added to the state set before every
+// symbol, so a run can start at any position, and every position where some
+// run is in an accepted state ends a match. matches are at least one symbol
+// long. the end offsets, counted in symbols from the start of the line, are
+// printed separated by commas, or with spans the start offset of the longest
+// match ending there, before a dash. the line is never held in memory. false
+// when the input has a symbol outside the alphabet
+bool searchNFA(const CompiledNFA & nfa, SymbolReader & input, ostream & out, bool spans, Profile* profile) {
+	const long long NONE = -1;
+	int n = nfa.states.size();
+	const Word* start = nfa.closureOf(nfa.start);
+	vector<Word> reachable_so_far(nfa.numWords, 0), scratch(nfa.numWords);
+	vector<long long> from, nextFrom; // with spans: the earliest start of a run in each state
+	if (spans) {
+		from.assign(n, NONE);
+		nextFrom.assign(n, NONE);
+	}
+	string text;
+	long long position = 0, matches = 0;
+	while (input.next(text)) {
+		int symbol = nfa.symbols.find(text);
+		if (symbol < 0 || !nfa.inAlphabet[symbol]) {
+			if (matches) { out << '\n'; }
+			out << "Invalid input: " << text << '\n';
+			return false;
+		}
+		long long matchStart = NONE;
+		bool matched = false;
+		if (!spans) {
+			for (int w = 0; w < nfa.numWords; ++w) { reachable_so_far[w] |= start[w]; }
+			stepStateSet(nfa, &reachable_so_far[0], symbol, &scratch[0]);
+			reachable_so_far.swap(scratch);
+			for (int w = 0; w < nfa.numWords; ++w) { matched |= (reachable_so_far[w] & nfa.accept[w]) != 0; }
+		} else {
+			// a run that starts here only fills the states no earlier run is in
+			for (int w = 0; w < nfa.numWords; ++w) {
+				for (Word bits = start[w]; bits; bits &= bits - 1) {
+					int s = w * WORD_BITS + __builtin_ctzll(bits);
+					if (from[s] == NONE) { from[s] = position; }
+				}
+			}
+			fill(nextFrom.begin(), nextFrom.end(), NONE);
+			for (int s = 0; s < n; ++s) {
+				if (from[s] == NONE) { continue; }
+				const Word* mask = nfa.successors(s, symbol);
+				for (int w = 0; w < nfa.numWords; ++w) {
+					for (Word bits = mask[w]; bits; bits &= bits - 1) {
+						long long & t = nextFrom[w * WORD_BITS + __builtin_ctzll(bits)];
+						if (t == NONE || from[s] < t) { t = from[s]; }
+					}
+				}
+			}
+			from.swap(nextFrom);
+			for (int s = 0; s < n; ++s) {
+				if (from[s] != NONE && ((nfa.accept[s / WORD_BITS] >> (s % WORD_BITS)) & 1) && (matchStart == NONE || from[s] < matchStart)) {
+					matchStart = from[s];
+				}
+			}
+			matched = (matchStart != NONE);
+		}
+		++position;
+		if (matched) {
+			if (matches++) { out << ','; }
+			if (spans) { out << matchStart << '-'; }
+			out << position;
+		}
+	}
+	if (profile) { profile->steps += position; }
+	out << (matches ? "" : "NO MATCH") << '\n';
+	return true;
+}
+
+// one piece of a case that is split across threads
+struct Piece {
+	string text;         // the symbols of the piece, without the commas around it
+	bool whole;          // whether the piece is the whole line, so that an empty one has no symbols
+	vector<int> symbols; // the symbols read from the text
+	string invalid;      // the first symbol outside the alphabet
+	bool valid;
+	vector<int> rowOf;   // the row of every state in rows
+	vector<Word> rows;   // the distinct sets reached from single states, numWords words each
+};
+
+// look up the symbols of a piece, stopping at the first one outside the alphabet
+void readPiece(const CompiledNFA & nfa, Piece & piece) {
+	lookUpPiece(piece.text, piece.whole, nfa.symbols, piece.symbols, piece.invalid);
+	piece.valid = true;
+	for (unsigned i = 0; i < piece.symbols.size() && piece.valid; ++i) {
+		int symbol = piece.symbols[i];
+		if (symbol < 0 || !nfa.inAlphabet[symbol]) {
+			if (symbol >= 0) { piece.invalid = nfa.symbols.name(symbol); }
+			piece.symbols.resize(i);
+			piece.valid = false;
+		}
+	}
+}
+
+// work out the set of states that reading a piece leads to from every single
+// state. runs from different states soon end up in the same set, so only the
+// distinct sets are stepped, and rows that become equal are merged after every symbol
+void relatePiece(const CompiledNFA & nfa, Piece & piece) {
+	int n = nfa.states.size(), words = nfa.numWords, numRows = n;
+	piece.rowOf.resize(n);
+	piece.rows.assign((unsigned long long)n * words, 0);
+	for (int s = 0; s < n; ++s) {
+		piece.rowOf[s] = s;
+		piece.rows[(unsigned long long)s * words + s / WORD_BITS] = 1ULL << (s % WORD_BITS);
+	}
+	vector<Word> next(piece.rows.size());
+	vector<int> merged(n);
+	unordered_map<string, int> seen;
+	for (unsigned i = 0; i < piece.symbols.size(); ++i) {
+		for (int r = 0; r < numRows; ++r) {
+			stepStateSet(nfa, &piece.rows[(unsigned long long)r * words], piece.symbols[i], &next[(unsigned long long)r * words]);
+		}
+		piece.rows.swap(next);
+		if (numRows == 1) { continue; }
+		seen.clear();
+		int kept = 0;
+		for (int r = 0; r < numRows; ++r) {
+			Word* row = &piece.rows[(unsigned long long)r * words];
+			pair<unordered_map<string, int>::iterator, bool> found = seen.insert(make_pair(string((const char*)row, words * sizeof(Word)), kept));
+			if (found.second) {
+				copy(row, row + words, &piece.rows[(unsigned long long)kept++ * words]);
+			}
+			merged[r] = found.first->second;
+		}
+		numRows = kept;
+		for (int s = 0; s < n; ++s) { piece.rowOf[s] = merged[piece.rowOf[s]]; }
+	}
+	piece.rows.resize((unsigned long long)numRows * words);
+}
 
+// same verdicts as analyzeCompiledNFA, for a single case too long for one
+// thread. the line is cut into pieces of about pieceSize bytes, a round of
+// numThreads pieces at a time. the first piece of a round is stepped from the
+// set reached so far, the others at the same time from every single state,
+// and their relations are then applied to the set in order. the line is never
+// held in memory as a whole
+bool analyzeSplit(const CompiledNFA & nfa, SymbolReader & input, ostream & out, const OutputMode & mode,
+	size_t pieceSize, int numThreads, Profile* profile) {
+	vector<Word> reachable_so_far(nfa.numWords, 0), scratch(nfa.numWords);
+	reachable_so_far[nfa.start / WORD_BITS] |= 1ULL << (nfa.start % WORD_BITS);
+	vector<Piece> pieces(numThreads);
+	string carry;
+	unsigned long long steps = 0;
+	bool ended = false;
+	while (!ended) {
+		int count = 0;
+		{
+			ProfileTimer timer(profile ? &profile->inputMillis : NULL);
+			while (count < numThreads && !ended) {
+				ended = cutLinePiece(input, pieceSize, carry, pieces[count].text);
+				pieces[count].whole = (steps == 0 && count == 0 && ended);
+				++count;
+			}
+		}
+		vector<thread> workers;
+		for (int p = 1; p < count; ++p) {
+			workers.push_back(thread([&nfa, &pieces, p]() {
+				readPiece(nfa, pieces[p]);
+				if (pieces[p].valid) { relatePiece(nfa, pieces[p]); }
+			}));
+		}
+		readPiece(nfa, pieces[0]);
+		const vector<int> & first = pieces[0].symbols;
+		for (unsigned i = 0; i < first.size(); ++i) {
+			// only the start set can be open, every step lands on a closed set
+			if (steps++ == 0) { closeStateSet(nfa, reachable_so_far); }
+			stepStateSet(nfa, &reachable_so_far[0], first[i], &scratch[0]);
+			reachable_so_far.swap(scratch);
+		}
+		for (unsigned t = 0; t < workers.size(); ++t) { workers[t].join(); }
+
+		// the first symbol outside the alphabet ends the case, as it would have one symbol at a time
+		for (int p = 0; p < count; ++p) {
+			if (!pieces[p].valid) {
+				out << "Invalid input: " << pieces[p].invalid << '\n';
+				return false;
+			}
+			if (p == 0) { continue; }
+			fill(scratch.begin(), scratch.end(), 0);
+			for (int w = 0; w < nfa.numWords; ++w) {
+				for (Word bits = reachable_so_far[w]; bits; bits &= bits - 1) {
+					const Word* row = &pieces[p].rows[(unsigned long long)pieces[p].rowOf[w * WORD_BITS + __builtin_ctzll(bits)] * nfa.numWords];
+					for (int i = 0; i < nfa.numWords; ++i) { scratch[i] |= row[i]; }
+				}
+			}
+			reachable_so_far.swap(scratch);
+			steps += pieces[p].symbols.size();
+		}
+		if (profile) { profile->peakStates = max(profile->peakStates, countStates(nfa, &reachable_so_far[0])); }
+	}
+	if (profile) { profile->steps += steps; }
+	for (int i = 0; i < nfa.numWords; ++i) {
+		if (reachable_so_far[i] & nfa.accept[i]) {
+			printVerdict(out, mode, "ACCEPT", steps);
+			return true;
+		}
+	}
+	printVerdict(out, mode, "REJECT", steps);
+	return true;
+}
+
+// a text description of an NFA as it was read
+struct NFADescription {
+	vector<string> alphabet;
+	vector<string> states;
+	map<pair<string, string>, vector<string> > transitions;
+	string start;
+	vector<string> end;
+};
+
+// read a text description, quitting on the first thing wrong with it
+void readDescription(const char* path, NFADescription & d) {
 	// exit program if input file is invalid
-	ifstream inf(argv[1], ios::in);
-	if (!inf) {
-		cout << "Invalid input file: %s" << argv[1] << endl;
+	DescriptionReader inf(path, DescriptionReader::WORDS);
+	if (!inf.good()) {
+		cout << "Invalid input file: %s" << path << endl;
 		exit(1);
 	}
 
 	// read the alphabet
 	string line;
-	inf >> line;
-	if (line[0] != 'A' || line[1] != ':') {
+	inf.next(line);
+	if (!readSection(line, 'A', d.alphabet)) {
 		cout << "Invalid description of the alphabet." << endl;
 		exit(1);
 	}
-	vector<string> alphabet = splitStringByDelimiter(line.substr(2), ',');
+	SymbolTable alphabetIds(d.alphabet);
 	
 	// read the states
-	inf >> line;
-	if (line[0] != 'Q' || line[1] != ':') {
+	inf.next(line);
+	if (!readSection(line, 'Q', d.states)) {
 		cout << "Invalid description of the states." << endl;
 		exit(1);
 	}
-	vector<string> states = splitStringByDelimiter(line.substr(2), ',');
+	SymbolTable stateIds(d.states);
 
 	// read the transitions
-	map<pair<string, string>, vector<string> > transitions;
-	while (inf >> line) {
-		if (line[0] != 'T' || line[1] != ':') { break; }
-		vector<string> transition = splitStringByDelimiter(line.substr(2), ',');
-		if (!isTransitionValid(transition, alphabet, states)) {
+	vector<string> transition;
+	while (inf.next(line) && readSection(line, 'T', transition)) {
+		if (!isTransitionValid(transition, alphabetIds, stateIds)) {
 			cout << "Invalid transition: " << line.substr(2) << endl;
 			exit(1);
 		}	
-		if (!transitions.count(make_pair(transition[0], transition[1]))) {
-			vector<string> tmpVector;
-			tmpVector.push_back(transition[2]);
-			transitions[make_pair(transition[0], transition[1])] = tmpVector;
-		} else {
-			transitions[make_pair(transition[0], transition[1])].push_back(transition[2]);
-		}
+		d.transitions[make_pair(transition[0], transition[1])].push_back(transition[2]);
 	}
 
 	// read the start state
-	if (line[0] != 'S' || line[1] != ':') {
+	if (line.size() < 2 || line[0] != 'S' || line[1] != ':') {
 		cout << "Invalid description of the start state." << endl;
 		exit(1);
-	} else if (!isInList(line.substr(2), states)) {
+	} else if (!stateIds.contains(line.substr(2))) {
 		cout << "Invalid start state: " << line.substr(2) << endl;
 		exit(1);
 	}
-	string start = line.substr(2);
+	d.start = line.substr(2);
 
 	// read the accepted states
-	inf >> line;
-	if (line[0] != 'F' || line[1] != ':') {
+	inf.next(line);
+	if (!readSection(line, 'F', d.end)) {
 		cout << "Invalid description of the accepted states." << endl;
 		exit(1);
 	}
-	vector<string> end = splitStringByDelimiter(line.substr(2), ',');
-	for (int i = 0; i < end.size(); ++i) {
-		if (!isInList(end[i], states)) {
-			cout << "Invalid accepted state: " << end[i] << endl;
+	for (unsigned i = 0; i < d.end.size(); ++i) {
+		if (!stateIds.contains(d.end[i])) {
+			cout << "Invalid accepted state: " << d.end[i] << endl;
 			exit(1);
 		}
 	}
+}
 
-	// read user input and output results
-	int numOfCases = 0;
-	cin >> numOfCases;
-	getline(cin, line);
-	bool isFirstCase = true;
-	while (numOfCases--) {
-		if (isFirstCase) { isFirstCase = false; } else { cout << endl; }
-		getline(cin, line);
-		vector<string> input = splitStringByDelimiter(line, ',');
-		analyzeNFA(alphabet, states, transitions, start, end, input);
+// write the compiled NFA out as an image
+void saveNFA(const CompiledNFA & nfa, const char* path) {
+	ImageWriter image("nfa");
+	image.putStrings(nfa.states);
+	image.putNames(nfa.symbols);
+	image.putFlags(nfa.inAlphabet);
+	image.put(nfa.numWords);
+	image.put(nfa.start);
+	image.putArray(nfa.closure.begin(), nfa.closure.size());
+	image.putArray(nfa.succ.begin(), nfa.succ.size());
+	image.putArray(nfa.accept.data(), nfa.accept.size());
+	image.save(path);
+}
+
+// load a compiled NFA from an image. the closure and successor masks, which
+// are nearly all of it, are used where they are in the mapped file
+void loadNFA(CompiledNFA & nfa, ImageReader & image) {
+	nfa.states = image.getStrings();
+	image.getNames(nfa.symbols);
+	nfa.inAlphabet = image.getFlags(nfa.symbols.size());
+	nfa.numWords = image.get<int>();
+	nfa.start = image.get<int>();
+	size_t n = nfa.states.size();
+	if (nfa.numWords != (int)((n + WORD_BITS - 1) / WORD_BITS) || nfa.start < 0 || nfa.start >= (int)n) { image.corrupt(); }
+	image.getArray(nfa.closure, n * nfa.numWords);
+	image.getArray(nfa.succ, n * nfa.symbols.size() * nfa.numWords);
+	const Word* accept = image.getArray<Word>(nfa.numWords);
+	nfa.accept.assign(accept, accept + nfa.numWords);
+	nfa.closureMillis = 0;
+}
+
+// get a description or an image ready as a compiled NFA. the image has to
+// stay open for as long as the NFA is used
+void prepareNFA(const char* path, ImageReader & image, CompiledNFA & nfa) {
+	if (image.open(path, "nfa")) {
+		loadNFA(nfa, image);
+		return;
+	}
+	NFADescription d;
+	readDescription(path, d);
+	compileNFA(nfa, d.alphabet, d.states, d.transitions, d.start, d.end);
+}
+
+// a DFA over the alphabet of an NFA, column a standing for symbol a + 1 of the
+// NFA. a missing transition is NONE, the dead state that accepts nothing
+struct DFA {
+	enum { NONE = -1 };
+	int numStates;
+	int numSymbols;
+	int start;
+	vector<int> next; // target of (state, column) at state * numSymbols + column
+	vector<bool> accepting;
+};
+
+// determinize the whole NFA by the subset construction. every closed state
+// set reachable from the start becomes a DFA state, and the empty set becomes
+// the dead state. the start state is one of its own: the simulators accept an
+// empty input by the start state alone, before its closure is taken. the
+// state set of every DFA state is left in stateSets when asked for, numWords
+// words each, the start state's being the closure it steps from. the
+// simulators also take "e" as an input symbol when the alphabet has it, which
+// is followed when onE is given, its target from every state left there
+void determinize(const CompiledNFA & nfa, DFA & dfa, vector<Word>* stateSets = NULL, vector<int>* onE = NULL) {
+	dfa.numSymbols = nfa.symbols.size() - 1;
+	dfa.numStates = 0;
+	dfa.start = 0;
+	dfa.next.clear();
+	dfa.accepting.clear();
+	if (onE) { onE->clear(); }
+	vector<Word> ownSets;
+	vector<Word> & sets = stateSets ? *stateSets : ownSets; // the state sets, numWords words each
+	unordered_map<string, int> index;
+	vector<Word> scratch(nfa.numWords);
+	auto add = [&](const Word* set) {
+		string key((const char*)set, nfa.numWords * sizeof(Word));
+		unordered_map<string, int>::const_iterator it = index.find(key);
+		if (it != index.end()) { return it->second; }
+		bool accepted = false;
+		for (int i = 0; i < nfa.numWords; ++i) { accepted |= (set[i] & nfa.accept[i]) != 0; }
+		sets.insert(sets.end(), set, set + nfa.numWords);
+		dfa.accepting.push_back(accepted);
+		index[key] = dfa.numStates;
+		return dfa.numStates++;
+	};
+
+	const Word* start = nfa.closureOf(nfa.start);
+	sets.assign(start, start + nfa.numWords);
+	dfa.accepting.push_back((nfa.accept[nfa.start / WORD_BITS] >> (nfa.start % WORD_BITS)) & 1);
+	dfa.numStates = 1;
+	for (int s = 0; s < dfa.numStates; ++s) {
+		for (int a = 0; a < dfa.numSymbols; ++a) {
+			int target = DFA::NONE;
+			if (nfa.inAlphabet[a + 1]) {
+				stepStateSet(nfa, &sets[(unsigned long long)s * nfa.numWords], a + 1, &scratch[0]);
+				if (countStates(nfa, &scratch[0])) { target = add(&scratch[0]); }
+			}
+			dfa.next.push_back(target);
+		}
+		if (onE && nfa.inAlphabet[0]) {
+			stepStateSet(nfa, &sets[(unsigned long long)s * nfa.numWords], 0, &scratch[0]);
+			onE->push_back(countStates(nfa, &scratch[0]) ? add(&scratch[0]) : DFA::NONE);
+		}
+	}
+}
+
+// minimize a DFA by hopcroft's partition refinement. the dead state is made
+// explicit as state numStates while refining, and the states that turn out to
+// be equivalent to it are dropped again. the states of the result are numbered
+// in breadth first order from the start, so equal languages over the same
+// alphabet give identical DFAs
+void minimize(const DFA & dfa, DFA & result) {
+	int n = dfa.numStates + 1, k = dfa.numSymbols, dead = dfa.numStates;
+	auto target = [&](int s, int a) {
+		int t = (s == dead) ? DFA::NONE : dfa.next[(unsigned long long)s * k + a];
+		return (t == DFA::NONE) ? dead : t;
+	};
+
+	// the transitions backwards, by symbol: the states that go to t on a are
+	// preds[predStart[a * (n + 1) + t] ... predStart[a * (n + 1) + t + 1])
+	vector<int> predStart((unsigned long long)k * (n + 1) + 1, 0), preds((unsigned long long)k * n);
+	for (int a = 0; a < k; ++a) {
+		for (int s = 0; s < n; ++s) { ++predStart[(unsigned long long)a * (n + 1) + target(s, a) + 1]; }
+	}
+	for (size_t i = 1; i < predStart.size(); ++i) { predStart[i] += predStart[i - 1]; }
+	vector<int> fill(predStart.begin(), predStart.end() - 1);
+	for (int a = 0; a < k; ++a) {
+		for (int s = 0; s < n; ++s) { preds[fill[(unsigned long long)a * (n + 1) + target(s, a)]++] = s; }
+	}
+
+	// the partition: the states of block b are elements[first[b] ... end[b]),
+	// and the ones marked by the current splitter are moved to its front
+	vector<int> elements(n), location(n), blockOf(n);
+	vector<int> first, end, marked;
+	for (int s = 0, i = 0; s < n; ++s) {
+		if (s == dead || !dfa.accepting[s]) { elements[i++] = s; }
+	}
+	int rejecting = n - count(dfa.accepting.begin(), dfa.accepting.end(), true);
+	for (int s = 0, i = rejecting; s < dfa.numStates; ++s) {
+		if (dfa.accepting[s]) { elements[i++] = s; }
+	}
+	for (int i = 0; i < n; ++i) {
+		location[elements[i]] = i;
+		blockOf[elements[i]] = (i < rejecting) ? 0 : 1;
+	}
+	first.push_back(0);
+	end.push_back(rejecting);
+	if (rejecting < n) {
+		first.push_back(rejecting);
+		end.push_back(n);
+	}
+	marked.assign(first.size(), 0);
+	vector<bool> waiting(first.size(), true);
+	vector<int> work;
+	for (int b = 0; b < (int)first.size(); ++b) { work.push_back(b); }
+
+	vector<int> splitter, touched;
+	while (!work.empty()) {
+		int b = work.back();
+		work.pop_back();
+		waiting[b] = false;
+		splitter.assign(elements.begin() + first[b], elements.begin() + end[b]);
+		for (int a = 0; a < k; ++a) {
+			// mark every state that goes into the splitter on a
+			for (unsigned i = 0; i < splitter.size(); ++i) {
+				unsigned long long at = (unsigned long long)a * (n + 1) + splitter[i];
+				for (int j = predStart[at]; j < predStart[at + 1]; ++j) {
+					int s = preds[j], y = blockOf[s];
+					int pos = location[s], to = first[y] + marked[y];
+					if (pos < to) { continue; }
+					if (marked[y]++ == 0) { touched.push_back(y); }
+					swap(elements[pos], elements[to]);
+					location[elements[pos]] = pos;
+					location[elements[to]] = to;
+				}
+			}
+			// split the blocks that were only partly marked
+			for (unsigned i = 0; i < touched.size(); ++i) {
+				int y = touched[i], m = marked[y];
+				marked[y] = 0;
+				if (m == end[y] - first[y]) { continue; }
+				int z = first.size();
+				first.push_back(first[y]);
+				end.push_back(first[y] + m);
+				marked.push_back(0);
+				first[y] += m;
+				for (int j = first[z]; j < end[z]; ++j) { blockOf[elements[j]] = z; }
+				// a waiting block is replaced by both halves, otherwise the smaller half does
+				if (waiting[y] || m <= end[y] - first[y]) {
+					waiting.push_back(true);
+					work.push_back(z);
+				} else {
+					waiting.push_back(false);
+				}
+				if (!waiting[y] && m > end[y] - first[y]) {
+					waiting[y] = true;
+					work.push_back(y);
+				}
+			}
+			touched.clear();
+		}
+	}
+
+	// number the live blocks from the start, leaving out the dead one
+	int deadBlock = blockOf[dead];
+	vector<int> number(first.size(), DFA::NONE);
+	vector<int> order;
+	result.numSymbols = k;
+	result.next.clear();
+	result.accepting.clear();
+	order.push_back(blockOf[dfa.start]);
+	number[order[0]] = 0;
+	result.start = 0;
+	for (unsigned i = 0; i < order.size(); ++i) {
+		int s = elements[first[order[i]]];
+		result.accepting.push_back(s != dead && dfa.accepting[s]);
+		for (int a = 0; a < k; ++a) {
+			int t = blockOf[target(s, a)];
+			if (t == deadBlock) {
+				result.next.push_back(DFA::NONE);
+				continue;
+			}
+			if (number[t] == DFA::NONE) {
+				number[t] = order.size();
+				order.push_back(t);
+			}
+			result.next.push_back(number[t]);
+		}
+	}
+	result.numStates = order.size();
+}
+
+// write a DFA out in the description format, its states named q0, q1, ...
+void writeDFA(const CompiledNFA & nfa, const DFA & dfa, const char* path) {
+	ofstream out(path);
+	vector<string> alphabet, states, accepted;
+	for (int a = 0; a < dfa.numSymbols; ++a) {
+		if (nfa.inAlphabet[a + 1]) { alphabet.push_back(nfa.symbols.name(a + 1)); }
+	}
+	for (int s = 0; s < dfa.numStates; ++s) {
+		states.push_back("q" + to_string(s));
+		if (dfa.accepting[s]) { accepted.push_back(states[s]); }
+	}
+	auto join = [](const vector<string> & v) {
+		string res;
+		for (unsigned i = 0; i < v.size(); ++i) { res += (i ? "," : "") + v[i]; }
+		return res;
+	};
+	out << "A:" << join(alphabet) << '\n' << "Q:" << join(states) << '\n';
+	for (int s = 0; s < dfa.numStates; ++s) {
+		for (int a = 0; a < dfa.numSymbols; ++a) {
+			int t = dfa.next[(unsigned long long)s * dfa.numSymbols + a];
+			if (t != DFA::NONE) { out << "T:" << states[s] << "," << nfa.symbols.name(a + 1) << "," << states[t] << '\n'; }
+		}
+	}
+	out << "S:" << states[dfa.start] << '\n' << "F:" << join(accepted) << '\n';
+	if (!out) {
+		cout << "Could not write the minimized automaton: " << path << endl;
+		exit(1);
 	}
 }
+
+// the part of an emitted simulator that does not depend on the NFA: a case
+// is one switch per symbol, the same verdicts and traces as analyzeCompiledNFA
+const char* NFA_SIMULATOR = R"SIM(
+// decide a case, false when it has a symbol outside the alphabet
+static bool analyze(SymbolReader & input, ostream & out, const OutputMode & mode) {
+	int state = 0;
+	if (mode.trace) { out << "; " << START << '\n'; }
+	string text;
+	unsigned long long steps = 0;
+	while (input.next(text)) {
+		int symbol = symbolOf(text);
+		if (symbol < 0) {
+			out << "Invalid input: " << text << '\n';
+			return false;
+		}
+		++steps;
+		state = step(state, symbol);
+		if (mode.trace) { out << text << "; " << STATE_SETS[state] << '\n'; }
+	}
+	printVerdict(out, mode, ACCEPTING[state] ? "ACCEPT" : "REJECT", steps);
+	return true;
+}
+
+int main(int argc, char** argv) {
+	OutputMode mode = { true, false, 1 };
+	int numThreads = 1;
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if (arg == "--quiet" || arg == "-q") {
+			mode.trace = false;
+		} else if (arg == "--steps") {
+			mode.stepCount = true;
+		} else if (arg.compare(0, 10, "--threads=") == 0) {
+			numThreads = parseThreadCount(arg.c_str() + 10);
+		} else {
+			cout << "usage: " << argv[0] << " [--quiet] [--steps] [--threads=<n>] < <input> > <output>" << endl;
+			exit(1);
+		}
+	}
+	bufferOutput();
+	SymbolReader reader(stdin);
+	bool valid = runCases(reader, numThreads, mode.trace, [&](int, SymbolReader & input, ostream & out) {
+		return analyze(input, out, mode);
+	});
+	return valid ? 0 : 1;
+}
+)SIM";
+
+// write a C++ simulator for this NFA alone: its DFA, with the transitions of
+// every state hard-coded as the cases of a switch and the dead state last.
+// "e" is the symbol after the columns of the DFA, when the alphabet has it.
+// it is built against the shared parts in lib, like ./nfa itself
+void emitNFA(const CompiledNFA & nfa, const DFA & dfa, const vector<Word> & sets, const vector<int> & onE, const char* description,
+	const char* path) {
+	ofstream out(path);
+	out << "/* " << path << "\n * The NFA of " << description << " as a DFA with its transitions compiled in,\n"
+		<< " * written by nfa --emit-cpp. It prints what ./nfa prints for the same input.\n */\n\n"
+		<< "#include <cstdlib>\n#include <cstring>\n#include <iostream>\n#include <string>\n#include \"automata.h\"\n"
+		<< "using namespace std;\n\n";
+
+	// the states of the NFA behind every DFA state, as they are traced
+	vector<string> names, symbolNames;
+	vector<int> columns;
+	for (int s = 0; s < dfa.numStates; ++s) {
+		names.push_back(printStateSetByDelim(nfa, &sets[(unsigned long long)s * nfa.numWords], ','));
+	}
+	names.push_back("");
+	for (int a = 0; a <= dfa.numSymbols; ++a) {
+		int symbol = (a < dfa.numSymbols) ? a + 1 : 0;
+		if (!nfa.inAlphabet[symbol]) { continue; }
+		symbolNames.push_back(nfa.symbols.name(symbol));
+		columns.push_back(a);
+	}
+	out << "// the DFA state for the empty set of NFA states, which no symbol leads out of\n"
+		<< "const int DEAD = " << dfa.numStates << ";\n\n";
+	out << "// the symbol of an input, -1 for one outside the alphabet\n";
+	emitLookup(out, "symbolOf", symbolNames, columns);
+	out << "\n// a case starts in the start state alone, which is closed before the first symbol\n"
+		<< "static const char* const START = " << cppLiteral(nfa.states[nfa.start]) << ";\n\n"
+		<< "// the NFA states of every DFA state, as a trace prints them\n";
+	emitNames(out, "STATE_SETS", names);
+	out << "\n// whether each DFA state accepts\nstatic const bool ACCEPTING[] = {";
+	for (int s = 0; s <= dfa.numStates; ++s) { out << (s ? ", " : " ") << ((s < dfa.numStates && dfa.accepting[s]) ? "true" : "false"); }
+	out << " };\n\n";
+
+	out << "// the state a symbol leads to\nstatic inline int step(int state, int symbol) {\n\tswitch (state) {\n";
+	for (int s = 0; s < dfa.numStates; ++s) {
+		out << "\tcase " << s << ":\n";
+		bool any = false;
+		for (int a = 0; a <= dfa.numSymbols; ++a) {
+			int t = (a < dfa.numSymbols) ? dfa.next[(unsigned long long)s * dfa.numSymbols + a] : onE.empty() ? DFA::NONE : onE[s];
+			if (t == DFA::NONE) { continue; }
+			if (!any) { out << "\t\tswitch (symbol) {\n"; }
+			any = true;
+			out << "\t\tcase " << a << ": return " << t << ";\n";
+		}
+		if (any) { out << "\t\t}\n"; }
+		out << "\t\tbreak;\n";
+	}
+	out << "\t}\n\treturn DEAD;\n}\n" << NFA_SIMULATOR;
+	if (!out) {
+		cout << "Could not write the C++ source: " << path << endl;
+		exit(1);
+	}
+}
+
+// check whether two NFAs accept the same language by walking the pairs of
+// states of their DFAs breadth first. a symbol that is only in one alphabet
+// leads to the dead state of the other DFA, as the other simulator would not
+// accept an input containing it. when they differ, the shortest input that
+// tells them apart is put into witness and the verdict of the first one
+// into firstAccepts
+bool equivalent(const CompiledNFA & nfa1, const DFA & dfa1, const CompiledNFA & nfa2, const DFA & dfa2,
+	vector<string> & witness, bool & firstAccepts) {
+	// the symbols of both alphabets, and the column of each one in either DFA
+	vector<string> symbols;
+	vector<int> column1, column2;
+	for (int a = 0; a < dfa1.numSymbols; ++a) {
+		if (!nfa1.inAlphabet[a + 1]) { continue; }
+		symbols.push_back(nfa1.symbols.name(a + 1));
+		column1.push_back(a);
+		int other = nfa2.symbols.find(symbols.back());
+		column2.push_back((other > 0 && nfa2.inAlphabet[other]) ? other - 1 : DFA::NONE);
+	}
+	for (int a = 0; a < dfa2.numSymbols; ++a) {
+		int other = nfa1.symbols.find(nfa2.symbols.name(a + 1));
+		if (!nfa2.inAlphabet[a + 1] || (other > 0 && nfa1.inAlphabet[other])) { continue; }
+		symbols.push_back(nfa2.symbols.name(a + 1));
+		column1.push_back(DFA::NONE);
+		column2.push_back(a);
+	}
+
+	// pairs of states, DFA::NONE for the dead state, with the pair and symbol they were reached by
+	struct Visit {
+		int state1, state2;
+		int from, symbol;
+	};
+	vector<Visit> queue;
+	unordered_map<unsigned long long, int> seen;
+	auto key = [&](int s1, int s2) { return (unsigned long long)(s1 + 1) * (dfa2.numStates + 1) + (s2 + 1); };
+	Visit start = { dfa1.start, dfa2.start, -1, -1 };
+	queue.push_back(start);
+	seen[key(start.state1, start.state2)] = 0;
+	for (unsigned i = 0; i < queue.size(); ++i) {
+		Visit v = queue[i];
+		bool accepts1 = v.state1 != DFA::NONE && dfa1.accepting[v.state1];
+		bool accepts2 = v.state2 != DFA::NONE && dfa2.accepting[v.state2];
+		if (accepts1 != accepts2) {
+			witness.clear();
+			for (int j = i; queue[j].from >= 0; j = queue[j].from) { witness.push_back(symbols[queue[j].symbol]); }
+			reverse(witness.begin(), witness.end());
+			firstAccepts = accepts1;
+			return false;
+		}
+		if (v.state1 == DFA::NONE && v.state2 == DFA::NONE) { continue; }
+		for (unsigned a = 0; a < symbols.size(); ++a) {
+			int t1 = (v.state1 == DFA::NONE || column1[a] == DFA::NONE) ? DFA::NONE : dfa1.next[(unsigned long long)v.state1 * dfa1.numSymbols + column1[a]];
+			int t2 = (v.state2 == DFA::NONE || column2[a] == DFA::NONE) ? DFA::NONE : dfa2.next[(unsigned long long)v.state2 * dfa2.numSymbols + column2[a]];
+			if (seen.count(key(t1, t2))) { continue; }
+			seen[key(t1, t2)] = queue.size();
+			Visit next = { t1, t2, (int)i, (int)a };
+			queue.push_back(next);
+		}
+	}
+	return true;
+}
+
+// print the usage message and quit
+void usage() {
+	cout << "usage: ./nfa [--engine=bitset|dfa|lanes|set] [--dfa-cache=<bytes>] [--threads=<n>] [--split=<bytes>] [--quiet] [--steps] [--search[=spans]] [--stats] [--profile[=<file>]] [--compile=<image>] [--minimize=<description>] [--equivalent=<nfa_description|image>] [--emit-cpp=<source>] <nfa_description|image> < <input> > <output>" << endl;
+	exit(1);
+}
+
+// the NFA simulator
+int run(int argc, char** argv) {
+	// read the options and the one and only description file
+	chrono::steady_clock::time_point started = chrono::steady_clock::now();
+	string engine = "bitset";
+	bool showStats = false;
+	bool profiling = false;
+	string profilePath;
+	bool searching = false, spans = false;
+	unsigned long long dfaCacheLimit = 64ULL << 20;
+	unsigned long long pieceSize = 0;
+	int numThreads = 1;
+	OutputMode mode = { true, false, 1 };
+	const char* description = NULL;
+	const char* compileTo = NULL;
+	const char* minimizeTo = NULL;
+	const char* compareWith = NULL;
+	const char* emitTo = NULL;
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if (arg.compare(0, 9, "--engine=") == 0) {
+			engine = arg.substr(9);
+			if (engine != "bitset" && engine != "dfa" && engine != "lanes" && engine != "set") { usage(); }
+		} else if (arg.compare(0, 12, "--dfa-cache=") == 0) {
+			dfaCacheLimit = parseSize(arg.substr(12));
+			if (!dfaCacheLimit) { usage(); }
+		} else if (arg.compare(0, 10, "--threads=") == 0) {
+			numThreads = parseThreadCount(arg.c_str() + 10);
+		} else if (arg.compare(0, 8, "--split=") == 0) {
+			pieceSize = parseSize(arg.substr(8));
+			if (!pieceSize) { usage(); }
+		} else if (arg == "--quiet" || arg == "-q") {
+			mode.trace = false;
+		} else if (arg == "--steps") {
+			mode.stepCount = true;
+		} else if (arg == "--search" || arg == "--search=spans") {
+			searching = true;
+			spans = (arg == "--search=spans");
+		} else if (arg == "--stats") {
+			showStats = true;
+		} else if (arg == "--profile" || arg.compare(0, 10, "--profile=") == 0) {
+			profiling = true;
+			profilePath = (arg.size() > 10) ? arg.substr(10) : "";
+		} else if (arg.compare(0, 10, "--compile=") == 0) {
+			compileTo = argv[i] + 10;
+		} else if (arg.compare(0, 11, "--minimize=") == 0) {
+			minimizeTo = argv[i] + 11;
+		} else if (arg.compare(0, 13, "--equivalent=") == 0) {
+			compareWith = argv[i] + 13;
+		} else if (arg.compare(0, 11, "--emit-cpp=") == 0) {
+			emitTo = argv[i] + 11;
+		} else if (arg[0] == '-' || description) {
+			usage();
+		} else {
+			description = argv[i];
+		}
+	}
+	if (!description) { usage(); }
+	if (searching) {
+		// a search prints its matches and nothing else, and needs the compiled NFA
+		mode.trace = false;
+		if (engine == "set" || engine == "lanes") { engine = "bitset"; }
+	}
+	if (pieceSize) {
+		// a split case runs on the compiled NFA, with all of the threads
+		if (searching || (mode.trace && !compileTo)) {
+			cout << "Splitting a case only decides it, use it with --quiet and without --search." << endl;
+			exit(1);
+		}
+		engine = "split";
+	}
+	if (engine == "lanes" && mode.trace && !compileTo) {
+		cout << "The lanes engine only prints verdicts, use it with --quiet." << endl;
+		exit(1);
+	}
+
+	// a compiled image is loaded as it is, a text description is read and checked
+	NFADescription d;
+	CompiledNFA nfa;
+	ImageReader image;
+	bool loaded = image.open(description, "nfa");
+	if (loaded && engine == "set") {
+		cout << "The set engine needs the text description." << endl;
+		exit(1);
+	}
+	if (loaded) {
+		loadNFA(nfa, image);
+	} else {
+		readDescription(description, d);
+	}
+
+	// intern the description for the compiled engine
+	if (!loaded && (engine != "set" || compileTo || minimizeTo || compareWith || emitTo)) { compileNFA(nfa, d.alphabet, d.states, d.transitions, d.start, d.end); }
+	if (compileTo) {
+		saveNFA(nfa, compileTo);
+		return 0;
+	}
+
+	// determinize and minimize, compile to C++ or compare instead of simulating
+	if (minimizeTo) {
+		// "e" read as an input symbol cannot be written out, a description
+		// always takes it for the empty string
+		if (nfa.inAlphabet[0]) {
+			cout << "An alphabet with e cannot be minimized into a description." << endl;
+			exit(1);
+		}
+		DFA dfa, minimal;
+		determinize(nfa, dfa);
+		minimize(dfa, minimal);
+		writeDFA(nfa, minimal, minimizeTo);
+		if (showStats) {
+			cerr << "minimized: " << nfa.states.size() << " nfa states, " << dfa.numStates << " dfa states, "
+				 << minimal.numStates << " after minimizing" << endl;
+		}
+		return 0;
+	}
+	if (emitTo) {
+		DFA dfa;
+		vector<Word> sets;
+		vector<int> onE;
+		determinize(nfa, dfa, &sets, &onE);
+		emitNFA(nfa, dfa, sets, onE, description, emitTo);
+		if (showStats) { cerr << "emitted: " << nfa.states.size() << " nfa states, " << dfa.numStates << " dfa states" << endl; }
+		return 0;
+	}
+	if (compareWith) {
+		ImageReader otherImage;
+		CompiledNFA other;
+		prepareNFA(compareWith, otherImage, other);
+		DFA dfa1, dfa2;
+		determinize(nfa, dfa1);
+		determinize(other, dfa2);
+		vector<string> witness;
+		bool firstAccepts = false;
+		if (equivalent(nfa, dfa1, other, dfa2, witness, firstAccepts)) {
+			cout << "EQUIVALENT" << endl;
+			return 0;
+		}
+		cout << "NOT EQUIVALENT" << endl;
+		for (unsigned i = 0; i < witness.size(); ++i) { cout << (i ? "," : "") << witness[i]; }
+		cout << endl << "accepted by " << (firstAccepts ? description : compareWith) << " only" << endl;
+		return 1;
+	}
+	if (showStats && engine != "set") {
+		cerr << "nfa: " << nfa.states.size() << " states, " << nfa.symbols.size() - 1 << " symbols, ";
+		if (loaded) { cerr << "loaded from a compiled image" << endl; }
+		else { cerr << "epsilon closures computed in " << nfa.closureMillis << " ms" << endl; }
+	}
+	double loadMillis = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+
+	// every thread gets its own share of the DFA cache, the compiled NFA itself is shared
+	vector<LazyDFA> dfas(numThreads, LazyDFA(nfa, dfaCacheLimit / numThreads));
+	vector<Profile> profiles(numThreads);
+	auto analyze = [&](int t, SymbolReader & input, ostream & out) {
+		Profile* profile = profiling ? &profiles[t] : NULL;
+		ProfileTimer timer(profile ? &profile->caseMillis : NULL);
+		if (profile) { ++profile->cases; }
+		if (searching) { return searchNFA(nfa, input, out, spans, profile); }
+		if (engine == "bitset") { return analyzeCompiledNFA(nfa, input, out, mode, profile); }
+		if (engine == "dfa") { return analyzeLazyDFA(dfas[t], nfa, input, out, mode, profile); }
+		if (engine == "split") { return analyzeSplit(nfa, input, out, mode, pieceSize, numThreads, profile); }
+		vector<string> symbols;
+		{
+			ProfileTimer reading(profile ? &profile->inputMillis : NULL);
+			string symbol;
+			while (input.next(symbol)) { symbols.push_back(symbol); }
+		}
+		return analyzeNFA(d.alphabet, d.transitions, d.start, d.end, symbols, out, mode, profile);
+	};
+
+	// read user input and output results, separating traces by blank lines.
+	// an input symbol outside the alphabet ends the run after its case
+	bufferOutput();
+	SymbolReader reader(stdin);
+	bool valid = true;
+	if (engine == "lanes") {
+		// the lanes engine takes the cases a batch at a time, on one thread
+		numThreads = 1;
+		int numOfCases = reader.readCount();
+		vector<string> batch;
+		vector<vector<int> > inputs(LANES);
+		for (int i = 0; i < numOfCases && valid; i += LANES) {
+			batch.resize(min(LANES, numOfCases - i));
+			for (unsigned j = 0; j < batch.size(); ++j) { reader.readLine(batch[j]); }
+			Profile* profile = profiling ? &profiles[0] : NULL;
+			ProfileTimer timer(profile ? &profile->caseMillis : NULL);
+			valid = analyzeLanes(nfa, batch, inputs, cout, mode, profile);
+		}
+	} else if (engine == "split") {
+		// the threads share each case instead of taking cases of their own
+		valid = runCases(reader, 1, mode.trace, analyze);
+	} else {
+		valid = runCases(reader, numThreads, mode.trace, analyze);
+	}
+	if (profiling) {
+		for (int t = 1; t < numThreads; ++t) { profiles[0].add(profiles[t]); }
+		writeProfile(profilePath, profiles[0], "nfa", searching ? "search" : engine, numThreads, loadMillis,
+			chrono::duration<double, milli>(chrono::steady_clock::now() - started).count());
+	}
+	if (!valid) { exit(1); }
+
+	if (showStats && engine == "dfa") {
+		unsigned long long hits = 0, misses = 0, flushes = 0, fallbacks = 0;
+		int size = 0;
+		for (int t = 0; t < numThreads; ++t) {
+			hits += dfas[t].hits;
+			misses += dfas[t].misses;
+			flushes += dfas[t].flushes;
+			fallbacks += dfas[t].fallbacks;
+			size += dfas[t].size();
+		}
+		cerr << "dfa cache: " << size << " states, " << hits << " hits, " << misses << " misses ("
+			 << (hits + misses ? 100.0 * hits / (hits + misses) : 0.0) << "% hit rate), " << flushes << " flushes, "
+			 << fallbacks << " fallbacks" << endl;
+	}
+	return 0;
+}
+
+} // namespace nfaEngine
+
+// the stand-alone ./nfa; the automata binary has a main of its own
+#ifndef AUTOMATA_CLI
+int main(int argc, char** argv) {
+	return nfaEngine::run(argc, argv);
+}
+#endif
@@ -4,35 +4,39 @@
  *     Date: Monday, March 30, 2015
  */
 
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <map>
-#include <stack>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
+#include "automata.h"
 using namespace std;
 
-// check if an item is in a container
-template <typename T>
-bool isInList(const T x, vector<T> l) {
-	return (find(l.begin(), l.end(), x) != l.end());
-}
+namespace dpdaEngine {
 
 // check if an individual transition is valid in terms of having the right states and alphabets
-bool isTransitionValid(vector<string> t, vector<string> states, vector<string> inputalpha, vector<string> stackalpha) {
-	return (isInList(t[0], states) && 
-		(t[1] == "e" || isInList(t[1], inputalpha)) && 
-		(t[2] == "e" || isInList(t[2], stackalpha)) && 
-		    isInList(t[3], states) &&
-		(t[4] == "e" || isInList(t[4], stackalpha)));
+bool isTransitionValid(const vector<string> & t, const SymbolTable & states, const SymbolTable & inputalpha, const SymbolTable & stackalpha) {
+	return (t.size() >= 5 &&
+		    states.contains(t[0]) && 
+		(t[1] == "e" || inputalpha.contains(t[1])) && 
+		(t[2] == "e" || stackalpha.contains(t[2])) && 
+		    states.contains(t[3]) &&
+		(t[4] == "e" || stackalpha.contains(t[4])));
 }
 
-// check if a transition can be allowed in an existing list of transitions
-bool isNewTransitionValid(map<string, map<pair<string, string>, pair<string, string> > > transitions, vector<string> transition) {
-	if (!transitions[transition[0]].size()) return true;
+// check if a transition can be allowed next to the transitions its state already has
+bool isNewTransitionValid(const map<pair<string, string>, pair<string, string> > & tmpMap, const vector<string> & transition) {
+	if (!tmpMap.size()) return true;
 	if (transition[1] == "e" && transition[2] == "e") return false;
-	map<pair<string, string>, pair<string, string> > tmpMap = transitions[transition[0]];
 	if (tmpMap.count(make_pair("e", "e"))) return false;
 	if (tmpMap.count(make_pair(transition[1], transition[2]))) return false;
 	if (transition[1] != "e" && transition[2] != "e") {
@@ -46,189 +50,1104 @@ bool isNewTransitionValid(map<string, map<pair<string, string>, pair<string, str
 	return true;
 }
 
-// split a string into tokens by a delimiter and store them in a vector
-vector<string> splitStringByDelimiter(string s, char delim) {
-	vector<string> v;
-	if (!s.size()) { return v; }
-	unsigned long long ind = s.find(delim);
-	while (ind < s.size()) {
-		v.push_back(s.substr(0, ind));
-		s = s.substr(ind + 1);
-		ind = s.find(delim);
+// one entry of the transition table: the state to go to and the stack symbol
+// to push, or no transition at all when next is NONE
+struct Move {
+	enum { NONE = -1 };
+	int next;
+	int push; // 0 pushes nothing
+};
+
+// what happens when a state keeps taking epsilon transitions while a given
+// symbol is on top of the stack (or the stack is empty), without looking at
+// anything below that symbol. either the run stops with the top replaced by
+// some symbols, or it pops the top and goes on with whatever is revealed, or it
+// never ends
+struct EpsilonRun {
+	enum { UNKNOWN, IN_PROGRESS, STOPS, POPS, DIVERGES };
+	int outcome;
+	int state;                // the state the run stops in, or is in once it pops the top
+	bool hitsAccept;          // whether the run enters an accepted state on the way
+	unsigned long long steps; // number of transitions, unless the run diverges
+	size_t peak;              // highest the stack gets, counted from below the top
+	size_t pushedAt;          // what the top is replaced by when the run stops, bottom first,
+	size_t pushedCount;       // as a slice of the pushed symbols of the DPDA
+};
+
+// the DPDA with states, input symbols and stack symbols interned to integers.
+// symbol 0 of both alphabets is "e", so the epsilon transitions of a state sit
+// in the same table as the others and each step is a single array lookup
+struct CompiledDPDA {
+	SymbolTable states;
+	SymbolTable inputs;
+	SymbolTable stackSymbols;
+	vector<bool> accepting;
+	int start;
+	FlatArray<Move> moves; // move of (state, input, stack top) at (state * inputs.size() + input) * stackSymbols.size() + top
+	FlatArray<EpsilonRun> epsilonRuns; // run of (state, stack top) at state * stackSymbols.size() + top, top 0 for an empty stack
+	FlatArray<int> pushedSymbols;      // what the epsilon runs push, one slice after another
+
+	Move & move(int state, int input, int top) {
+		return moves[((unsigned long long)state * inputs.size() + input) * stackSymbols.size() + top];
+	}
+	const Move & move(int state, int input, int top) const {
+		return moves[((unsigned long long)state * inputs.size() + input) * stackSymbols.size() + top];
+	}
+	const EpsilonRun & epsilonRun(int state, int top) const {
+		return epsilonRuns[(unsigned long long)state * stackSymbols.size() + top];
 	}
-	v.push_back(s);
-	return v;
+};
+
+// work out the epsilon run of every (state, stack top) pair. the run of a pair
+// is one transition followed by the run of another pair, so each one is solved
+// once from the ones it leads to. the pairs being solved are kept on an
+// explicit stack instead of recursing, since the chains can be as long as
+// there are pairs. meeting a pair that is still being solved means the
+// configuration repeats without anything below it being popped: the run never
+// ends, and it passes through every pair solved since then
+void computeEpsilonRuns(CompiledDPDA & dpda) {
+	int numStack = dpda.stackSymbols.size();
+	EpsilonRun unknown = { EpsilonRun::UNKNOWN, -1, false, 0, 0, 0, 0 };
+	dpda.epsilonRuns.assign((unsigned long long)dpda.states.size() * numStack, unknown);
+
+	// a pair being solved: the part of its run found so far and the pair whose
+	// run comes next, either on the same level or on a symbol pushed above it
+	struct Frame {
+		int pair;
+		int top;
+		int next;
+		bool above;
+		EpsilonRun run;
+		vector<int> pushed;
+	};
+	vector<Frame> frames;
+	vector<int> pushed; // the slices of the finished runs
+	vector<int> frameOf(dpda.epsilonRuns.size(), -1);
+
+	for (int root = 0; root < (int)dpda.epsilonRuns.size(); ++root) {
+		if (dpda.epsilonRuns[root].outcome != EpsilonRun::UNKNOWN) continue;
+		int pending = root;
+		while (pending >= 0 || !frames.empty()) {
+			// open a pair: take its first transition, if it has one
+			if (pending >= 0) {
+				Frame f;
+				f.pair = pending;
+				f.top = pending % numStack;
+				f.next = -1;
+				f.above = false;
+				int state = pending / numStack;
+				size_t base = (f.top != 0);
+				EpsilonRun run = { EpsilonRun::STOPS, state, false, 0, base, 0, 0 };
+				const Move & free = dpda.move(state, 0, 0);
+				const Move* m = (free.next != Move::NONE || !f.top) ? &free : &dpda.move(state, 0, f.top);
+				if (m->next != Move::NONE) {
+					run.steps = 1;
+					run.hitsAccept = dpda.accepting[m->next];
+					if (m == &free && m->push) {
+						f.next = m->next * numStack + m->push;
+						f.above = true;
+					} else if (m == &free) {
+						f.next = m->next * numStack + f.top;
+					} else if (m->push) {
+						f.next = m->next * numStack + m->push;
+					} else {
+						run.outcome = EpsilonRun::POPS;
+						run.state = m->next;
+					}
+				}
+				if (run.outcome == EpsilonRun::STOPS && f.next < 0 && f.top) f.pushed.push_back(f.top);
+				f.run = run;
+				dpda.epsilonRuns[pending].outcome = EpsilonRun::IN_PROGRESS;
+				frameOf[pending] = frames.size();
+				frames.push_back(f);
+				pending = -1;
+			}
+
+			Frame & f = frames.back();
+			if (f.next >= 0) {
+				const EpsilonRun & next = dpda.epsilonRuns[f.next];
+				if (next.outcome == EpsilonRun::UNKNOWN) {
+					pending = f.next;
+					continue;
+				}
+				if (next.outcome == EpsilonRun::IN_PROGRESS) {
+					// a loop: every pair from the repeated one up diverges
+					int first = frameOf[f.next];
+					bool hitsAccept = false;
+					for (int i = first; i < (int)frames.size(); ++i) { hitsAccept = hitsAccept || frames[i].run.hitsAccept; }
+					for (int i = first; i < (int)frames.size(); ++i) {
+						EpsilonRun & run = frames[i].run;
+						run.outcome = EpsilonRun::DIVERGES;
+						run.hitsAccept = hitsAccept;
+						dpda.epsilonRuns[frames[i].pair] = run;
+						frameOf[frames[i].pair] = -1;
+					}
+					frames.resize(first);
+					continue;
+				}
+
+				// the next run is known, so append it
+				size_t base = f.above ? (f.top != 0) : 0;
+				f.run.steps += next.steps;
+				f.run.hitsAccept = f.run.hitsAccept || next.hitsAccept;
+				f.run.peak = max(f.run.peak, base + next.peak);
+				f.run.outcome = next.outcome;
+				f.run.state = next.state;
+				if (f.above && next.outcome == EpsilonRun::POPS) {
+					// the pushed symbol is gone again and our top is back
+					f.next = next.state * numStack + f.top;
+					f.above = false;
+					continue;
+				}
+				if (f.above && f.top && next.outcome == EpsilonRun::STOPS) f.pushed.push_back(f.top);
+				f.pushed.insert(f.pushed.end(), pushed.begin() + next.pushedAt, pushed.begin() + next.pushedAt + next.pushedCount);
+			}
+			f.run.pushedAt = pushed.size();
+			f.run.pushedCount = f.pushed.size();
+			pushed.insert(pushed.end(), f.pushed.begin(), f.pushed.end());
+			dpda.epsilonRuns[f.pair] = f.run;
+			frameOf[f.pair] = -1;
+			frames.pop_back();
+		}
+	}
+	dpda.pushedSymbols.adopt(pushed);
 }
 
-// print the elements of a stack from the top to the bottom followed by a newline character
-void printStack(stack<string> s) {
-	if (!s.empty()) {
-		cout << " " << s.top();
-		s.pop();
-		while (!s.empty()) {
-			cout << "," << s.top();
-			s.pop();
+// intern a parsed description and lay its transitions out in a flat table
+void compileDPDA(CompiledDPDA & dpda, const vector<string> & states, const vector<string> & inputalpha, const vector<string> & stackalpha,
+	const map<string, map<pair<string, string>, pair<string, string> > > & transitions, const string & start, const vector<string> & end) {
+	for (unsigned i = 0; i < states.size(); ++i) { dpda.states.intern(states[i]); }
+	dpda.inputs.intern("e");
+	for (unsigned i = 0; i < inputalpha.size(); ++i) { dpda.inputs.intern(inputalpha[i]); }
+	dpda.stackSymbols.intern("e");
+	for (unsigned i = 0; i < stackalpha.size(); ++i) { dpda.stackSymbols.intern(stackalpha[i]); }
+	dpda.accepting.assign(dpda.states.size(), false);
+	for (unsigned i = 0; i < end.size(); ++i) { dpda.accepting[dpda.states.find(end[i])] = true; }
+	dpda.start = dpda.states.find(start);
+
+	Move none = { Move::NONE, 0 };
+	dpda.moves.assign((unsigned long long)dpda.states.size() * dpda.inputs.size() * dpda.stackSymbols.size(), none);
+	for (map<string, map<pair<string, string>, pair<string, string> > >::const_iterator it = transitions.begin(); it != transitions.end(); ++it) {
+		int state = dpda.states.find(it->first);
+		for (map<pair<string, string>, pair<string, string> >::const_iterator t = it->second.begin(); t != it->second.end(); ++t) {
+			Move & m = dpda.move(state, dpda.inputs.find(t->first.first), dpda.stackSymbols.find(t->first.second));
+			m.next = dpda.states.find(t->second.first);
+			m.push = dpda.stackSymbols.find(t->second.second);
 		}
 	}
-	cout << endl;
+	computeEpsilonRuns(dpda);
+}
+
+// the stack of a run is a contiguous array of stack symbol ids with the top at
+// the back, so it can be printed or inspected in place without being copied
+typedef vector<int> Stack;
+
+// print the elements of a stack from the top to the bottom followed by a newline character
+void printStack(ostream & out, const CompiledDPDA & dpda, const Stack & s) {
+	for (Stack::const_reverse_iterator it = s.rbegin(); it != s.rend(); ++it) {
+		out << ((it == s.rbegin()) ? " " : ",") << dpda.stackSymbols.name(*it);
+	}
+	out << '\n';
+}
+
+// the outcome of trying to take a transition
+enum StepResult { STUCK, MOVED, OVERFLOWED };
+
+// take one transition on an input symbol (0 for the empty string), printing it
+// when tracing. a transition that would make the stack deeper than maxDepth is
+// not taken; a maxDepth of 0 means the stack may grow without limit
+StepResult takeTransition(ostream & out, const CompiledDPDA & dpda, int & curr_state, Stack & curr_stack, int input,
+	const OutputMode & mode, size_t maxDepth, Profile* profile) {
+	int top = 0;
+	const Move* m = &dpda.move(curr_state, input, 0);
+	if (profile) { ++profile->lookups; }
+	if (m->next == Move::NONE) {
+		if (curr_stack.empty()) { return STUCK; }
+		top = curr_stack.back();
+		m = &dpda.move(curr_state, input, top);
+		if (profile) { ++profile->lookups; }
+		if (m->next == Move::NONE) { return STUCK; }
+	}
+	if (maxDepth && m->push && curr_stack.size() - (top != 0) >= maxDepth) { return OVERFLOWED; }
+	if (mode.trace) {
+		ProfileTimer timer(profile ? &profile->outputMillis : NULL);
+		out << dpda.states.name(curr_state) << "; " << dpda.inputs.name(input) << "; " << dpda.stackSymbols.name(top) << "; "
+			 << dpda.states.name(m->next) << ";";
+	}
+	if (top) curr_stack.pop_back();
+	if (m->push) curr_stack.push_back(m->push);
+	curr_state = m->next;
+	if (profile) {
+		++profile->steps;
+		if (!input) { ++profile->epsilonMoves; }
+		profile->peakStack = max(profile->peakStack, (unsigned long long)curr_stack.size());
+	}
+	if (mode.trace) {
+		ProfileTimer timer(profile ? &profile->outputMillis : NULL);
+		printStack(out, dpda, curr_stack);
+	}
+	return MOVED;
 }
 
 // assume the input is empty string and see how far we can go in the DPDA
 // the didInputFinish variable is basically a switch. when it's true, we will check if the current state is an accept state and stop accordingly
-void reachOutWithEmptyStringInput(string & curr_state, stack<string> & curr_stack, map<string, map<pair<string, string>, pair<string, string> > > transitions, vector<string> end, bool didInputFinish = false) {
-	while (transitions[curr_state].count(make_pair("e", "e")) || 
-		  (!curr_stack.empty() && transitions[curr_state].count(make_pair("e", curr_stack.top())))) {
-		if (transitions[curr_state].count(make_pair("e", "e"))) {
-			cout << curr_state << "; e; e; " << transitions[curr_state][make_pair("e", "e")].first << ";";
-			string newElem = transitions[curr_state][make_pair("e", "e")].second;
-			if (newElem != "e") curr_stack.push(newElem);
-			curr_state = transitions[curr_state][make_pair("e", "e")].first;
+// the run is followed one precomputed epsilon run at a time: when nothing has to
+// be printed and it can neither accept nor overflow the stack part way through,
+// a whole run is applied at once. a run that never ends is reported instead
+// of followed. returns false when the run was cut short
+bool reachOutWithEmptyStringInput(ostream & out, const CompiledDPDA & dpda, int & curr_state, Stack & curr_stack,
+	const OutputMode & mode, size_t maxDepth, unsigned long long & steps, Profile* profile, bool didInputFinish = false) {
+	while (true) {
+		int top = curr_stack.empty() ? 0 : curr_stack.back();
+		const EpsilonRun & run = dpda.epsilonRun(curr_state, top);
+		if (profile) { ++profile->lookups; }
+		if (run.steps == 0 && run.outcome == EpsilonRun::STOPS) break;
+		bool accepts = didInputFinish && run.hitsAccept;
+		if (run.outcome == EpsilonRun::DIVERGES && !accepts) {
+			printVerdict(out, mode, "DID NOT HALT", steps);
+			return false;
+		}
+
+		size_t below = curr_stack.size() - (top != 0);
+		if (mode.trace || accepts || (maxDepth && below + run.peak > maxDepth)) {
+			// walk through the transitions of this run one by one
+			for (unsigned long long i = 0; run.outcome == EpsilonRun::DIVERGES || i < run.steps; ++i) {
+				if (takeTransition(out, dpda, curr_state, curr_stack, 0, mode, maxDepth, profile) == OVERFLOWED) {
+					printVerdict(out, mode, "STACK LIMIT EXCEEDED", steps);
+					return false;
+				}
+				++steps;
+				if (didInputFinish && dpda.accepting[curr_state]) {
+					printVerdict(out, mode, "ACCEPT", steps);
+					return true;
+				}
+			}
 		} else {
-			string stackTop = curr_stack.top();
-			cout << curr_state << "; e; " << stackTop << "; " << transitions[curr_state][make_pair("e", stackTop)].first << ";";
-			curr_stack.pop();
-			string newElem = transitions[curr_state][make_pair("e", stackTop)].second;
-			if (newElem != "e") curr_stack.push(newElem);
-			curr_state = transitions[curr_state][make_pair("e", stackTop)].first;
-        }
-		printStack(curr_stack);
-		if (didInputFinish && isInList(curr_state, end)) {
-			cout << "ACCEPT" << endl;
-			return;
+			if (top) curr_stack.pop_back();
+			curr_stack.insert(curr_stack.end(), dpda.pushedSymbols.begin() + run.pushedAt, dpda.pushedSymbols.begin() + run.pushedAt + run.pushedCount);
+			curr_state = run.state;
+			steps += run.steps;
+			if (profile) {
+				profile->steps += run.steps;
+				profile->epsilonMoves += run.steps;
+				profile->peakStack = max(profile->peakStack, (unsigned long long)(below + run.peak));
+			}
 		}
+		if (run.outcome == EpsilonRun::STOPS) break;
+	}
+	if (didInputFinish) printVerdict(out, mode, "REJECT", steps);
+	return true;
+}
+
+// take the transition on one input symbol, -1 for one outside the alphabet,
+// and the epsilon moves after it, deciding the case after the last symbol of
+// the line. false when the case was decided part way through
+bool consumeSymbol(ostream & out, const CompiledDPDA & dpda, int & curr_state, Stack & curr_stack, int input, bool last,
+	const OutputMode & mode, size_t maxDepth, unsigned long long & steps, Profile* profile) {
+	// symbols outside the alphabet have no transitions
+	StepResult result = (input < 0) ? STUCK : takeTransition(out, dpda, curr_state, curr_stack, input, mode, maxDepth, profile);
+	if (result != MOVED) {
+		printVerdict(out, mode, (result == STUCK) ? "REJECT" : "STACK LIMIT EXCEEDED", steps);
+		return false;
 	}
-	if (didInputFinish) cout << "REJECT" << endl;
+	++steps;
+	return reachOutWithEmptyStringInput(out, dpda, curr_state, curr_stack, mode, maxDepth, steps, profile, last);
 }
 
 // meat of the DPDA analyses
-void analyzeDPDA(map<string, map<pair<string, string>, pair<string, string> > > transitions, string start, vector<string> end, vector<string> input) {
-	string curr_state = start;
-	stack<string> curr_stack;
-	reachOutWithEmptyStringInput(curr_state, curr_stack, transitions, end);
-
-	for (int i = 0; i < input.size(); ++i) {
-		if (transitions[curr_state].count(make_pair(input[i], "e"))) {
-			cout << curr_state << "; " << input[i] << "; e; " << transitions[curr_state][make_pair(input[i], "e")].first << ";";
-			string newElem = transitions[curr_state][make_pair(input[i], "e")].second;
-			if (newElem != "e") curr_stack.push(newElem);
-			curr_state = transitions[curr_state][make_pair(input[i], "e")].first;
-		} else if (!curr_stack.empty() && transitions[curr_state].count(make_pair(input[i], curr_stack.top()))) {
-			string stackTop = curr_stack.top();
-			cout << curr_state << "; " << input[i] << "; " << stackTop << "; " << transitions[curr_state][make_pair(input[i], stackTop)].first << ";";
-			curr_stack.pop();
-			string newElem = transitions[curr_state][make_pair(input[i], stackTop)].second;
-			if (newElem != "e") curr_stack.push(newElem);
-			curr_state = transitions[curr_state][make_pair(input[i], stackTop)].first;
-		} else {
-			cout << "REJECT" << endl;
+void analyzeDPDA(const CompiledDPDA & dpda, SymbolReader & input, ostream & out, const OutputMode & mode, size_t maxDepth, Profile* profile) {
+	int curr_state = dpda.start;
+	Stack curr_stack;
+	unsigned long long steps = 0;
+	if (!reachOutWithEmptyStringInput(out, dpda, curr_state, curr_stack, mode, maxDepth, steps, profile)) {
+		input.skipLine();
+		return;
+	}
+
+	string symbol;
+	bool isFirstSymbol = true;
+	while (input.next(symbol)) {
+		isFirstSymbol = false;
+		if (!consumeSymbol(out, dpda, curr_state, curr_stack, dpda.inputs.find(symbol), input.lineEnded(), mode, maxDepth, steps, profile)) {
+			input.skipLine();
 			return;
 		}
-		printStack(curr_stack);
-		if (i != input.size() - 1) {
-			reachOutWithEmptyStringInput(curr_state, curr_stack, transitions, end);
-			continue;
+	}
+	// without input there is no verdict, keep one line per case when that is all we print
+	if (isFirstSymbol && !mode.trace) out << '\n';
+}
+
+// a case that is split across threads is cut into pieces, and each piece is
+// run ahead of time from every state a run can rest in between two symbols,
+// over a stack that is not known yet. a run that has to look below the stack
+// it started on stops there and goes on once for every symbol that could be
+// revealed, 0 standing for the bottom of the stack, so the runs of a piece
+// form a tree with a look at every branch. heights are counted from the height
+// of the stack when the piece starts
+struct Look {
+	size_t position;          // the symbol of the piece the run stopped at
+	bool beforeTransition;    // whether it stopped before the transition on that symbol or in the epsilon moves after it
+	int state;
+	unsigned long long steps;
+	long long peak;           // highest the stack got
+	long long popped;         // symbols from below the start of the piece taken off the stack so far
+};
+
+// where a run of a piece ends: at the end of the piece with some symbols left
+// on the stack above the ones it popped, or with a verdict part way through
+struct PieceEnd {
+	const char* verdict;
+	int state;
+	unsigned long long steps;
+	long long peak;
+	long long popped;
+	size_t pushedAt;    // what is left on the stack, bottom first,
+	size_t pushedCount; // as a slice of pushed
+};
+
+// the link to what a run reached: a look, an end at -2 - the index of the end,
+// or STUCK_LINK for a run rejected as soon as it looked
+const int STUCK_LINK = -1;
+const int NO_RUN = INT_MIN;
+
+struct DPDAPiece {
+	string text;          // the symbols of the piece, without the commas around it
+	bool whole;           // whether the piece is the whole line
+	bool last;            // whether the piece ends the line
+	vector<int> symbols;  // the input symbols of the piece, -1 for one outside the alphabet
+	int held;             // the last symbol of the line, taken out of the piece to decide the case with
+	bool summarized;      // false when the runs branched too much to follow
+	vector<int> roots;    // the run from every state, NO_RUN for the ones a run never rests in
+	vector<Look> looks;
+	vector<int> links;    // what each look leads to for every stack symbol it may reveal
+	vector<PieceEnd> ends;
+	vector<int> pushed;
+};
+
+// the bookkeeping of the runs of a piece. runs from different states or
+// symbols often end up in the same configuration within a few symbols, so the
+// configurations a run goes through at first are remembered, and a run that
+// meets one of them reaches what the earlier run did
+struct PieceRuns {
+	enum { REMEMBERED = 16 }; // symbols at the start of a run whose configurations are remembered
+	size_t work;              // symbols gone through by all of the runs
+	size_t budget;            // work to give up at
+	unordered_map<string, int> seen; // the run that went through a configuration
+	vector<int> reached;      // the link to what each run reached
+};
+
+// follow a run of a piece from where a look left it, with local the part of
+// the stack it knows and bottom whether that is all of it, the same way
+// consumeSymbol would step the real configuration. stops at the end of the
+// piece, at a verdict or where the run has to look further down the stack,
+// or returns NO_RUN once the runs have used up their budget
+int runPiece(const CompiledDPDA & dpda, DPDAPiece & piece, PieceRuns & runs, Look at, Stack & local, bool bottom) {
+	const char* verdict = NULL;
+	int id = runs.reached.size();
+	runs.reached.push_back(NO_RUN);
+	if (++runs.work > runs.budget) return NO_RUN;
+	size_t remembered = at.position + PieceRuns::REMEMBERED;
+	string key;
+	while (true) {
+		int top = local.empty() ? 0 : local.back();
+		bool needsLook = local.empty() && !bottom;
+		if (at.beforeTransition) {
+			if (at.position == piece.symbols.size()) break;
+			if (++runs.work > runs.budget) return NO_RUN;
+			if (at.position < remembered) {
+				long long fields[] = { (long long)at.position, at.state, (long long)at.steps, at.peak, at.popped, bottom };
+				key.assign((const char*)fields, sizeof(fields));
+				key.append((const char*)local.data(), local.size() * sizeof(int));
+				pair<unordered_map<string, int>::iterator, bool> found = runs.seen.insert(make_pair(key, id));
+				if (!found.second) return runs.reached[id] = runs.reached[found.first->second];
+			}
+			int input = piece.symbols[at.position];
+			if (input < 0) {
+				verdict = "REJECT";
+				break;
+			}
+			const Move* m = &dpda.move(at.state, input, 0);
+			if (m->next != Move::NONE) {
+				top = 0;
+			} else {
+				if (needsLook) break;
+				if (!top || dpda.move(at.state, input, top).next == Move::NONE) {
+					verdict = "REJECT";
+					break;
+				}
+				m = &dpda.move(at.state, input, top);
+			}
+			if (top) local.pop_back();
+			if (m->push) local.push_back(m->push);
+			at.state = m->next;
+			++at.steps;
+			at.peak = max(at.peak, (long long)local.size() - at.popped);
+			at.beforeTransition = false;
+		} else {
+			if (needsLook) break;
+			const EpsilonRun & run = dpda.epsilonRun(at.state, top);
+			if (run.outcome == EpsilonRun::DIVERGES) {
+				verdict = "DID NOT HALT";
+				break;
+			}
+			if (run.steps) {
+				at.peak = max(at.peak, (long long)local.size() - (top != 0) - at.popped + (long long)run.peak);
+				if (top) local.pop_back();
+				local.insert(local.end(), dpda.pushedSymbols.begin() + run.pushedAt, dpda.pushedSymbols.begin() + run.pushedAt + run.pushedCount);
+				at.state = run.state;
+				at.steps += run.steps;
+			}
+			if (run.outcome == EpsilonRun::STOPS) {
+				++at.position;
+				at.beforeTransition = true;
+			}
 		}
-		reachOutWithEmptyStringInput(curr_state, curr_stack, transitions, end, true);
 	}
+	if (!verdict && at.position < piece.symbols.size()) {
+		piece.looks.push_back(at);
+		piece.links.resize(piece.links.size() + dpda.stackSymbols.size(), STUCK_LINK);
+		return runs.reached[id] = piece.looks.size() - 1;
+	}
+	PieceEnd end = { verdict, at.state, at.steps, at.peak, at.popped, piece.pushed.size(), verdict ? 0 : local.size() };
+	if (!verdict) piece.pushed.insert(piece.pushed.end(), local.begin(), local.end());
+	piece.ends.push_back(end);
+	return runs.reached[id] = -2 - (int)(piece.ends.size() - 1);
 }
 
-int main(int argc, char** argv) {
+// whether the transition or the epsilon moves a run stopped at for a look
+// put the revealed symbol back as they found it, taking them if so. the run
+// can then go on without knowing the symbol, for as long as it leaves it be
+bool peekPiece(const CompiledDPDA & dpda, const DPDAPiece & piece, Look & at, int symbol) {
+	if (at.beforeTransition) {
+		const Move & m = dpda.move(at.state, piece.symbols[at.position], symbol);
+		if (m.next == Move::NONE || m.push != symbol) return false;
+		at.state = m.next;
+		++at.steps;
+		at.peak = max(at.peak, -at.popped);
+		at.beforeTransition = false;
+		return true;
+	}
+	const EpsilonRun & run = dpda.epsilonRun(at.state, symbol);
+	if (run.outcome != EpsilonRun::STOPS || run.pushedCount != 1 || dpda.pushedSymbols[run.pushedAt] != symbol) return false;
+	at.peak = max(at.peak, -at.popped - 1 + (long long)run.peak);
+	at.state = run.state;
+	at.steps += run.steps;
+	++at.position;
+	at.beforeTransition = true;
+	return true;
+}
 
-	// check the number of arguments
-	if (argc != 2) {
-		cout << "usage: ./dpda <dpda_config>  <  <input_file>  >  <output_file>" << endl;
-		exit(1);
-    }
+// whether a run that looked is rejected before taking another step when it
+// finds symbol, 0 standing for the bottom of the stack
+bool stuckAfterLook(const CompiledDPDA & dpda, const DPDAPiece & piece, Look at, int symbol) {
+	if (!at.beforeTransition) {
+		const EpsilonRun & run = dpda.epsilonRun(at.state, symbol);
+		if (run.steps != 0 || run.outcome != EpsilonRun::STOPS || ++at.position == piece.symbols.size()) return false;
+	}
+	int input = piece.symbols[at.position];
+	return input < 0 || (dpda.move(at.state, input, 0).next == Move::NONE && (!symbol || dpda.move(at.state, input, symbol).next == Move::NONE));
+}
+
+// run a piece from every resting state and every stack it may find below
+// it. the symbols a look only peeks at in the same way share one run, and a
+// run rejected right after a look is only marked in its link, as is a top of
+// the stack the run cannot have rested on to begin with. gives up once the
+// runs have gone through several times as many symbols as the piece has, as
+// they do when the DPDA looks deep into the stack without being stopped by the input
+void summarizePiece(const CompiledDPDA & dpda, const vector<bool> & resting, DPDAPiece & piece) {
+	int numStack = dpda.stackSymbols.size();
+	piece.looks.clear();
+	piece.links.clear();
+	piece.ends.clear();
+	piece.pushed.clear();
+	piece.roots.assign(dpda.states.size(), NO_RUN);
+	piece.summarized = false;
+	PieceRuns runs;
+	runs.work = 0;
+	runs.budget = 4 * piece.symbols.size() + 1024;
+	vector<int> pending; // the looks whose runs are still to be followed
+	vector<pair<Look, int> > peeks;
+	Stack local;
+	for (int q = 0; q < dpda.states.size(); ++q) {
+		if (find(resting.begin() + q * numStack, resting.begin() + (q + 1) * numStack, true) == resting.begin() + (q + 1) * numStack) continue;
+		Look start = { 0, true, q, 0, 0, 0 };
+		local.clear();
+		size_t looks = piece.looks.size();
+		piece.roots[q] = runPiece(dpda, piece, runs, start, local, false);
+		if (piece.roots[q] == NO_RUN) return;
+		if (piece.looks.size() > looks) pending.push_back(piece.roots[q]);
+	}
+	while (!pending.empty()) {
+		int look = pending.back();
+		pending.pop_back();
+		peeks.clear();
+		for (int v = 0; v < numStack; ++v) {
+			Look at = piece.looks[look];
+			if ((at.steps == 0 && !resting[at.state * numStack + v]) || stuckAfterLook(dpda, piece, at, v)) continue;
+			int link = NO_RUN;
+			size_t looks = piece.looks.size();
+			if (v && peekPiece(dpda, piece, at, v)) {
+				for (unsigned i = 0; i < peeks.size() && link == NO_RUN; ++i) {
+					const Look & other = peeks[i].first;
+					if (other.state == at.state && other.steps == at.steps && other.peak == at.peak) link = peeks[i].second;
+				}
+				if (link == NO_RUN) {
+					local.clear();
+					link = runPiece(dpda, piece, runs, at, local, false);
+					peeks.push_back(make_pair(at, link));
+				}
+			} else {
+				local.assign(v ? 1 : 0, v);
+				if (v) ++at.popped;
+				link = runPiece(dpda, piece, runs, at, local, v == 0);
+			}
+			if (link == NO_RUN) return;
+			if (piece.looks.size() > looks) pending.push_back(link);
+			piece.links[(unsigned long long)look * numStack + v] = link;
+		}
+	}
+	piece.summarized = true;
+}
+
+// step the real configuration through the symbols of a piece one at a time
+bool runPieceAsIs(ostream & out, const CompiledDPDA & dpda, const DPDAPiece & piece, int & curr_state, Stack & curr_stack,
+	const OutputMode & mode, size_t maxDepth, unsigned long long & steps, Profile* profile) {
+	for (unsigned i = 0; i < piece.symbols.size(); ++i) {
+		if (!consumeSymbol(out, dpda, curr_state, curr_stack, piece.symbols[i], false, mode, maxDepth, steps, profile)) return false;
+	}
+	return true;
+}
+
+// carry the real configuration through a summarized piece by following the
+// tree of its runs down the real stack. a piece whose runs may overflow the
+// stack from here is stepped through instead. false when the case was decided
+bool applyPiece(ostream & out, const CompiledDPDA & dpda, const DPDAPiece & piece, int & curr_state, Stack & curr_stack,
+	const OutputMode & mode, size_t maxDepth, unsigned long long & steps, Profile* profile) {
+	if (!piece.summarized || piece.roots[curr_state] == NO_RUN) {
+		return runPieceAsIs(out, dpda, piece, curr_state, curr_stack, mode, maxDepth, steps, profile);
+	}
+	int link = piece.roots[curr_state];
+	const Look* look = NULL;
+	while (link >= 0) {
+		look = &piece.looks[link];
+		size_t depth = look->popped;
+		int symbol = (depth < curr_stack.size()) ? curr_stack[curr_stack.size() - 1 - depth] : 0;
+		link = piece.links[(unsigned long long)link * dpda.stackSymbols.size() + symbol];
+	}
+	PieceEnd stuck = { "REJECT", curr_state, look ? look->steps : 0, look ? look->peak : 0, 0, 0, 0 };
+	const PieceEnd & end = (link == STUCK_LINK) ? stuck : piece.ends[-2 - link];
+	if (maxDepth && (long long)curr_stack.size() + end.peak > (long long)maxDepth) {
+		return runPieceAsIs(out, dpda, piece, curr_state, curr_stack, mode, maxDepth, steps, profile);
+	}
+	steps += end.steps;
+	if (profile) {
+		profile->steps += end.steps;
+		profile->peakStack = max(profile->peakStack, (unsigned long long)(curr_stack.size() + end.peak));
+	}
+	if (end.verdict) {
+		printVerdict(out, mode, end.verdict, steps);
+		return false;
+	}
+	curr_stack.resize(curr_stack.size() - end.popped);
+	curr_stack.insert(curr_stack.end(), piece.pushed.begin() + end.pushedAt, piece.pushed.begin() + end.pushedAt + end.pushedCount);
+	curr_state = end.state;
+	return true;
+}
+
+// look up the symbols of a piece, taking the last symbol of the line out of it
+void readPiece(const CompiledDPDA & dpda, DPDAPiece & piece) {
+	string unknown;
+	lookUpPiece(piece.text, piece.whole, dpda.inputs, piece.symbols, unknown);
+	piece.held = -1;
+	if (piece.last && !piece.symbols.empty() && piece.symbols.back() >= 0) {
+		piece.held = piece.symbols.back();
+		piece.symbols.pop_back();
+	}
+}
 
+// same verdicts as analyzeDPDA, for a single case too long for one thread. the
+// line is cut into pieces of about pieceSize bytes, a round of numThreads
+// pieces at a time. the first piece of a round is stepped from the real
+// configuration while the others are summarized, then the summaries are
+// applied in order. the last symbol of the line is always stepped, since the
+// epsilon moves after it decide the case
+void analyzeSplit(const CompiledDPDA & dpda, const vector<bool> & resting, SymbolReader & input, ostream & out, const OutputMode & mode,
+	size_t maxDepth, size_t pieceSize, int numThreads, Profile* profile) {
+	int curr_state = dpda.start;
+	Stack curr_stack;
+	unsigned long long steps = 0;
+	if (!reachOutWithEmptyStringInput(out, dpda, curr_state, curr_stack, mode, maxDepth, steps, profile)) {
+		input.skipLine();
+		return;
+	}
+
+	vector<DPDAPiece> pieces(numThreads);
+	string carry;
+	bool ended = false, first = true;
+	while (!ended) {
+		int count = 0;
+		{
+			ProfileTimer timer(profile ? &profile->inputMillis : NULL);
+			while (count < numThreads && !ended) {
+				ended = cutLinePiece(input, pieceSize, carry, pieces[count].text);
+				pieces[count].whole = first && ended;
+				pieces[count].last = ended;
+				first = false;
+				++count;
+			}
+		}
+		vector<thread> workers;
+		for (int p = 1; p < count; ++p) {
+			workers.push_back(thread([&dpda, &resting, &pieces, p]() {
+				readPiece(dpda, pieces[p]);
+				summarizePiece(dpda, resting, pieces[p]);
+			}));
+		}
+		readPiece(dpda, pieces[0]);
+		bool going = runPieceAsIs(out, dpda, pieces[0], curr_state, curr_stack, mode, maxDepth, steps, profile);
+		for (unsigned t = 0; t < workers.size(); ++t) { workers[t].join(); }
+		for (int p = 1; p < count && going; ++p) {
+			going = applyPiece(out, dpda, pieces[p], curr_state, curr_stack, mode, maxDepth, steps, profile);
+		}
+		if (!going) {
+			if (!ended) input.skipLine();
+			return;
+		}
+		if (ended) {
+			// without input there is no verdict, keep one line per case when that is all we print
+			const DPDAPiece & last = pieces[count - 1];
+			if (last.held >= 0) consumeSymbol(out, dpda, curr_state, curr_stack, last.held, true, mode, maxDepth, steps, profile);
+			else if (!mode.trace) out << '\n';
+		}
+	}
+}
+
+// a text description of a DPDA as it was read
+struct DPDADescription {
+	vector<string> states;
+	vector<string> inputalpha;
+	vector<string> stackalpha;
+	map<string, map<pair<string, string>, pair<string, string> > > transitions;
+	string start;
+	vector<string> end;
+};
+
+// read a text description, quitting on the first thing wrong with it
+void readDescription(const char* path, DPDADescription & d) {
 	// check if the input file exists and is readable
-	ifstream inf(argv[1], ios::in);
-	if (!inf) {
-		cout << "Invalid input file: %s" << argv[1] << endl;
+	DescriptionReader inf(path, DescriptionReader::WORDS);
+	if (!inf.good()) {
+		cout << "Invalid input file: %s" << path << endl;
 		exit(1);
 	}
 
     // read the set of states
 	string line;
-	inf >> line;
-	if (line[0] != 'Q' || line[1] != ':') {
+	inf.next(line);
+	if (!readSection(line, 'Q', d.states)) {
 		cout << "Missing description of the set of states." << endl;
 		exit(1);
 	}
-	vector<string> states = splitStringByDelimiter(line.substr(2), ',');
+	SymbolTable stateIds(d.states);
 
 	// read the input alphabet
-	inf >> line;
-	if (line[0] != 'A' || line[1] != ':') {
+	inf.next(line);
+	if (!readSection(line, 'A', d.inputalpha)) {
 		cout << "Missing description of the input alphabet." << endl;
 		exit(1);
 	}
-	vector<string> inputalpha = splitStringByDelimiter(line.substr(2), ',');
+	SymbolTable inputIds(d.inputalpha);
 	
     // read the stack alphabet
-	inf >> line;
-	if (line[0] != 'Z' || line[1] != ':') {
+	inf.next(line);
+	if (!readSection(line, 'Z', d.stackalpha)) {
 		cout << "Missing description of the stack alphabet." << endl;
 		exit(1);
 	}
-	vector<string> stackalpha = splitStringByDelimiter(line.substr(2), ',');
+	SymbolTable stackIds(d.stackalpha);
 
 	// read the transition rules
-	map<string, map<pair<string, string>, pair<string, string> > > transitions;
-	while (inf >> line) {
-		if (line[0] != 'T' || line[1] != ':') { break; }
-		vector<string> transition = splitStringByDelimiter(line.substr(2), ',');
-		
-		if (!isTransitionValid(transition, states, inputalpha, stackalpha)) {
+	vector<string> transition;
+	while (inf.next(line) && readSection(line, 'T', transition)) {
+		if (!isTransitionValid(transition, stateIds, inputIds, stackIds)) {
 			cout << "Invalid transition: " << line.substr(2) << endl;
 			exit(1);
 		}	
 		
-		if (!transitions.count(transition[0])) {
-			map<pair<string, string>, pair<string, string> > tmpMap;
-			transitions[transition[0]] = tmpMap;
-		} 
-		
-		if (!isNewTransitionValid(transitions, transition)) {
+		map<pair<string, string>, pair<string, string> > & fromState = d.transitions[transition[0]];
+		if (!isNewTransitionValid(fromState, transition)) {
 			cout << "Invalid transition: " << line.substr(2) << endl;
 			exit(1);
 		}
 
-		transitions[transition[0]][make_pair(transition[1], transition[2])] = make_pair(transition[3], transition[4]);
+		fromState[make_pair(transition[1], transition[2])] = make_pair(transition[3], transition[4]);
 	}
 
 	// read the start state
-	if (line[0] != 'S' || line[1] != ':') {
+	if (line.size() < 2 || line[0] != 'S' || line[1] != ':') {
 		cout << "Missing description of the start state." << endl;
 		exit(1);
-	} else if (!isInList(line.substr(2), states)) {
+	} else if (!stateIds.contains(line.substr(2))) {
 		cout << "Invalid start state: " << line.substr(2) << endl;
 		exit(1);
 	}
-	string start = line.substr(2);
+	d.start = line.substr(2);
 
 	// read the list of accepted states
-	inf >> line;
-	if (line[0] != 'F' || line[1] != ':') {
+	inf.next(line);
+	if (!readSection(line, 'F', d.end)) {
 		cout << "Missing description of the accepted states." << endl;
 		exit(1);
 	}
-	vector<string> end = splitStringByDelimiter(line.substr(2), ',');
-	for (int i = 0; i < end.size(); ++i) {
-		if (!isInList(end[i], states)) {
-			cout << "Invalid accepted state: " << end[i] << endl;
+	for (unsigned i = 0; i < d.end.size(); ++i) {
+		if (!stateIds.contains(d.end[i])) {
+			cout << "Invalid accepted state: " << d.end[i] << endl;
+			exit(1);
+		}
+	}
+}
+
+// write the compiled DPDA out as an image
+void saveDPDA(const CompiledDPDA & dpda, const char* path) {
+	ImageWriter image("dpda");
+	image.putNames(dpda.states);
+	image.putNames(dpda.inputs);
+	image.putNames(dpda.stackSymbols);
+	image.putFlags(dpda.accepting);
+	image.put(dpda.start);
+	image.putArray(dpda.moves.begin(), dpda.moves.size());
+	image.putArray(dpda.epsilonRuns.begin(), dpda.epsilonRuns.size());
+	image.putArray(dpda.pushedSymbols.begin(), dpda.pushedSymbols.size());
+	image.save(path);
+}
+
+// load a compiled DPDA from an image. the transition table and the epsilon
+// runs are used where they are in the mapped file
+void loadDPDA(CompiledDPDA & dpda, ImageReader & image) {
+	image.getNames(dpda.states);
+	image.getNames(dpda.inputs);
+	image.getNames(dpda.stackSymbols);
+	dpda.accepting = image.getFlags(dpda.states.size());
+	dpda.start = image.get<int>();
+	if (dpda.start < 0 || dpda.start >= dpda.states.size()) { image.corrupt(); }
+	image.getArray(dpda.moves, (size_t)dpda.states.size() * dpda.inputs.size() * dpda.stackSymbols.size());
+	image.getArray(dpda.epsilonRuns, (size_t)dpda.states.size() * dpda.stackSymbols.size());
+	image.getArray(dpda.pushedSymbols);
+}
+
+// the part of an emitted simulator that does not depend on the DPDA. it
+// takes the same steps as takeTransition and reachOutWithEmptyStringInput,
+// with the transitions coming from the generated switch
+const char* DPDA_SIMULATOR = R"SIM(
+typedef vector<int> Stack;
+
+// print the elements of a stack from the top to the bottom followed by a newline character
+static void printStack(ostream & out, const Stack & s) {
+	for (Stack::const_reverse_iterator it = s.rbegin(); it != s.rend(); ++it) {
+		out << ((it == s.rbegin()) ? " " : ",") << STACK_SYMBOLS[*it];
+	}
+	out << '\n';
+}
+
+enum StepResult { STUCK, MOVED, OVERFLOWED };
+
+// take one transition on an input symbol (0 for the empty string), printing it
+// when tracing. a transition that would make the stack deeper than maxDepth is not taken
+static inline StepResult takeTransition(ostream & out, int & state, Stack & stack, int input, const OutputMode & mode, size_t maxDepth) {
+	int next, push;
+	int top = transition(state, input, stack.empty() ? 0 : stack.back(), next, push);
+	if (top < 0) { return STUCK; }
+	if (maxDepth && push && stack.size() - (top != 0) >= maxDepth) { return OVERFLOWED; }
+	if (mode.trace) { out << STATES[state] << "; " << INPUTS[input] << "; " << STACK_SYMBOLS[top] << "; " << STATES[next] << ";"; }
+	if (top) { stack.pop_back(); }
+	if (push) { stack.push_back(push); }
+	state = next;
+	if (mode.trace) { printStack(out, stack); }
+	return MOVED;
+}
+
+// take the epsilon moves from here one precomputed run at a time, deciding the
+// case when the input has finished. false when the run was cut short
+static bool reachOut(ostream & out, int & state, Stack & stack, const OutputMode & mode, size_t maxDepth,
+	unsigned long long & steps, bool didInputFinish) {
+	while (true) {
+		int top = stack.empty() ? 0 : stack.back();
+		const EpsilonRun & run = RUNS[state * NUM_STACK + top];
+		if (run.steps == 0 && run.outcome == STOPS) { break; }
+		bool accepts = didInputFinish && run.hitsAccept;
+		if (run.outcome == DIVERGES && !accepts) {
+			printVerdict(out, mode, "DID NOT HALT", steps);
+			return false;
+		}
+		size_t below = stack.size() - (top != 0);
+		if (mode.trace || accepts || (maxDepth && below + run.peak > maxDepth)) {
+			for (unsigned long long i = 0; run.outcome == DIVERGES || i < run.steps; ++i) {
+				if (takeTransition(out, state, stack, 0, mode, maxDepth) == OVERFLOWED) {
+					printVerdict(out, mode, "STACK LIMIT EXCEEDED", steps);
+					return false;
+				}
+				++steps;
+				if (didInputFinish && ACCEPTING[state]) {
+					printVerdict(out, mode, "ACCEPT", steps);
+					return true;
+				}
+			}
+		} else {
+			if (top) { stack.pop_back(); }
+			stack.insert(stack.end(), PUSHED + run.pushedAt, PUSHED + run.pushedAt + run.pushedCount);
+			state = run.state;
+			steps += run.steps;
+		}
+		if (run.outcome == STOPS) { break; }
+	}
+	if (didInputFinish) { printVerdict(out, mode, "REJECT", steps); }
+	return true;
+}
+
+// decide a case, skipping what is left of its line once it is decided
+static void analyze(SymbolReader & input, ostream & out, const OutputMode & mode, size_t maxDepth) {
+	int state = START;
+	Stack stack;
+	unsigned long long steps = 0;
+	if (!reachOut(out, state, stack, mode, maxDepth, steps, false)) {
+		input.skipLine();
+		return;
+	}
+	string text;
+	bool isFirstSymbol = true;
+	while (input.next(text)) {
+		isFirstSymbol = false;
+		int symbol = inputOf(text);
+		StepResult result = (symbol < 0) ? STUCK : takeTransition(out, state, stack, symbol, mode, maxDepth);
+		if (result != MOVED) {
+			printVerdict(out, mode, (result == STUCK) ? "REJECT" : "STACK LIMIT EXCEEDED", steps);
+			input.skipLine();
+			return;
+		}
+		++steps;
+		if (!reachOut(out, state, stack, mode, maxDepth, steps, input.lineEnded())) {
+			input.skipLine();
+			return;
+		}
+	}
+	if (isFirstSymbol && !mode.trace) { out << '\n'; }
+}
+
+int main(int argc, char** argv) {
+	OutputMode mode = { true, false, 1 };
+	size_t maxDepth = 0;
+	int numThreads = 1;
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if (arg == "--quiet" || arg == "-q") {
+			mode.trace = false;
+		} else if (arg == "--steps") {
+			mode.stepCount = true;
+		} else if (arg.compare(0, 12, "--max-stack=") == 0) {
+			maxDepth = strtoull(arg.c_str() + 12, NULL, 10);
+		} else if (arg.compare(0, 10, "--threads=") == 0) {
+			numThreads = parseThreadCount(arg.c_str() + 10);
+		} else {
+			cout << "usage: " << argv[0] << " [--quiet] [--steps] [--max-stack=<depth>] [--threads=<n>] < <input> > <output>" << endl;
 			exit(1);
 		}
 	}
+	bufferOutput();
+	SymbolReader reader(stdin);
+	runCases(reader, numThreads, mode.trace, [&](int, SymbolReader & input, ostream & out) {
+		analyze(input, out, mode, maxDepth);
+		return true;
+	});
+	return 0;
+}
+)SIM";
+
+// write a C++ simulator for this DPDA alone. the transitions of every state
+// are hard-coded as the cases of nested switches on the input symbol and the
+// stack top, and the epsilon runs go along as a constant table
+void emitDPDA(const CompiledDPDA & dpda, const char* description, const char* path) {
+	ofstream out(path);
+	out << "/* " << path << "\n * The DPDA of " << description << " with its transitions compiled in,\n"
+		<< " * written by dpda --emit-cpp. It prints what ./dpda prints for the same input.\n */\n\n"
+		<< "#include <cstdlib>\n#include <cstring>\n#include <iostream>\n#include <string>\n#include <vector>\n#include \"automata.h\"\n"
+		<< "using namespace std;\n\n";
+
+	int numStates = dpda.states.size(), numInputs = dpda.inputs.size(), numStack = dpda.stackSymbols.size();
+	vector<string> states, inputs, stackSymbols;
+	vector<int> ids;
+	for (int i = 0; i < numStates; ++i) { states.push_back(dpda.states.name(i)); }
+	for (int i = 0; i < numInputs; ++i) {
+		inputs.push_back(dpda.inputs.name(i));
+		ids.push_back(i);
+	}
+	for (int i = 0; i < numStack; ++i) { stackSymbols.push_back(dpda.stackSymbols.name(i)); }
+	out << "// stack symbols, 0 standing for the empty string and for an empty stack\nconst int NUM_STACK = " << numStack << ";\n"
+		<< "const int START = " << dpda.start << ";\n\n";
+	out << "// the input symbol of a name, 0 for \"e\" and -1 for one outside the alphabet\n";
+	emitLookup(out, "inputOf", inputs, ids);
+	out << "\n// the names of the states and symbols, as traces print them\n";
+	emitNames(out, "STATES", states);
+	emitNames(out, "INPUTS", inputs);
+	emitNames(out, "STACK_SYMBOLS", stackSymbols);
+	out << "\n// whether each state accepts\nstatic const bool ACCEPTING[] = {";
+	for (int i = 0; i < numStates; ++i) { out << (i ? ", " : " ") << (dpda.accepting[i] ? "true" : "false"); }
+	out << " };\n\n";
+
+	// a transition that leaves the stack alone is tried before the ones that pop its top
+	out << "// the transition of a state on an input symbol (0 for the empty string)\n"
+		<< "// with top on the stack, 0 for an empty one. gives the stack symbol it\n"
+		<< "// pops, 0 for none, or -1 when there is no transition\n"
+		<< "static inline int transition(int state, int input, int top, int & next, int & push) {\n\tswitch (state) {\n";
+	for (int s = 0; s < numStates; ++s) {
+		ostringstream cases;
+		for (int a = 0; a < numInputs; ++a) {
+			const Move & free = dpda.move(s, a, 0);
+			if (free.next != Move::NONE) {
+				cases << "\t\tcase " << a << ": next = " << free.next << "; push = " << free.push << "; return 0;\n";
+				continue;
+			}
+			ostringstream tops;
+			for (int t = 1; t < numStack; ++t) {
+				const Move & m = dpda.move(s, a, t);
+				if (m.next != Move::NONE) { tops << "\t\t\tcase " << t << ": next = " << m.next << "; push = " << m.push << "; return " << t << ";\n"; }
+			}
+			if (!tops.str().empty()) { cases << "\t\tcase " << a << ":\n\t\t\tswitch (top) {\n" << tops.str() << "\t\t\t}\n\t\t\tbreak;\n"; }
+		}
+		if (!cases.str().empty()) { out << "\tcase " << s << ":\n\t\tswitch (input) {\n" << cases.str() << "\t\t}\n\t\tbreak;\n"; }
+	}
+	out << "\t}\n\treturn -1;\n}\n\n";
+
+	// the epsilon runs as compileDPDA worked them out
+	out << "// what a state does on epsilon moves alone with a given top, at state * NUM_STACK + top\n"
+		<< "struct EpsilonRun {\n\tint outcome;\n\tint state;\n\tbool hitsAccept;\n\tunsigned long long steps;\n"
+		<< "\tsize_t peak;\n\tsize_t pushedAt;\n\tsize_t pushedCount;\n};\n"
+		<< "enum { STOPS = " << (int)EpsilonRun::STOPS << ", POPS = " << (int)EpsilonRun::POPS << ", DIVERGES = " << (int)EpsilonRun::DIVERGES << " };\n"
+		<< "static const EpsilonRun RUNS[] = {\n";
+	for (unsigned i = 0; i < dpda.epsilonRuns.size(); ++i) {
+		const EpsilonRun & r = dpda.epsilonRuns[i];
+		out << "\t{ " << r.outcome << ", " << r.state << ", " << (r.hitsAccept ? "true" : "false") << ", " << r.steps << "ULL, "
+			<< r.peak << ", " << r.pushedAt << ", " << r.pushedCount << " },\n";
+	}
+	out << "};\nstatic const int PUSHED[] = {";
+	for (unsigned i = 0; i < dpda.pushedSymbols.size(); ++i) { out << (i ? ", " : " ") << dpda.pushedSymbols[i]; }
+	out << (dpda.pushedSymbols.size() ? " };\n" : " 0 };\n") << DPDA_SIMULATOR;
+	if (!out) {
+		cout << "Could not write the C++ source: " << path << endl;
+		exit(1);
+	}
+}
+
+// print the usage message and quit
+void usage() {
+	cout << "usage: ./dpda [--quiet] [--steps] [--max-stack=<depth>] [--threads=<n>] [--split=<bytes>] [--profile[=<file>]] [--compile=<image>] [--emit-cpp=<source>] <dpda_config|image>  <  <input_file>  >  <output_file>" << endl;
+	exit(1);
+}
+
+// the DPDA simulator
+int run(int argc, char** argv) {
+
+	// read the options and the one and only description file
+	chrono::steady_clock::time_point started = chrono::steady_clock::now();
+	OutputMode mode = { true, false, 1 };
+	bool profiling = false;
+	string profilePath;
+	size_t maxDepth = 0;
+	int numThreads = 1;
+	unsigned long long pieceSize = 0;
+	const char* description = NULL;
+	const char* compileTo = NULL;
+	const char* emitTo = NULL;
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if (arg == "--quiet" || arg == "-q") {
+			mode.trace = false;
+		} else if (arg == "--steps") {
+			mode.stepCount = true;
+		} else if (arg.compare(0, 12, "--max-stack=") == 0) {
+			maxDepth = strtoull(arg.c_str() + 12, NULL, 10);
+		} else if (arg.compare(0, 10, "--threads=") == 0) {
+			numThreads = parseThreadCount(arg.c_str() + 10);
+		} else if (arg.compare(0, 8, "--split=") == 0) {
+			pieceSize = parseSize(arg.substr(8));
+			if (!pieceSize) { usage(); }
+		} else if (arg == "--profile" || arg.compare(0, 10, "--profile=") == 0) {
+			profiling = true;
+			profilePath = (arg.size() > 10) ? arg.substr(10) : "";
+		} else if (arg.compare(0, 10, "--compile=") == 0) {
+			compileTo = argv[i] + 10;
+		} else if (arg.compare(0, 11, "--emit-cpp=") == 0) {
+			emitTo = argv[i] + 11;
+		} else if (arg[0] == '-' || description) {
+			usage();
+		} else {
+			description = argv[i];
+		}
+	}
+	if (!description) { usage(); }
+	if (pieceSize && mode.trace && !compileTo) {
+		cout << "Splitting a case only decides it, use it with --quiet." << endl;
+		exit(1);
+	}
+
+	// a compiled image is loaded as it is, a text description is read, checked
+	// and interned into its transition table
+	CompiledDPDA dpda;
+	ImageReader image;
+	if (image.open(description, "dpda")) {
+		loadDPDA(dpda, image);
+	} else {
+		DPDADescription d;
+		readDescription(description, d);
+		compileDPDA(dpda, d.states, d.inputalpha, d.stackalpha, d.transitions, d.start, d.end);
+	}
+	if (compileTo) {
+		saveDPDA(dpda, compileTo);
+		return 0;
+	}
+	if (emitTo) {
+		emitDPDA(dpda, description, emitTo);
+		return 0;
+	}
 
-	// read user input and output results
-	int numOfCases = 0;
-	cin >> numOfCases;
-	getline(cin, line);
-	bool isFirstCase = true;
-	while (numOfCases--) {
-		if (isFirstCase) { isFirstCase = false; } else { cout << endl; }
-		getline(cin, line);
-		vector<string> input = splitStringByDelimiter(line, ',');
-		analyzeDPDA(transitions, start, end, input);
+	double loadMillis = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+
+	// the states and stack tops a run can be in between two input symbols,
+	// which the pieces of a split case start from
+	vector<bool> resting(dpda.epsilonRuns.size());
+	for (unsigned i = 0; i < resting.size(); ++i) {
+		resting[i] = (dpda.epsilonRuns[i].steps == 0 && dpda.epsilonRuns[i].outcome == EpsilonRun::STOPS);
+	}
+
+	// read user input and output results, separating traces by blank lines.
+	// several threads share the compiled DPDA and only read it. the threads
+	// share each case instead of taking cases of their own when it is split
+	bufferOutput();
+	SymbolReader reader(stdin);
+	vector<Profile> profiles(numThreads);
+	runCases(reader, pieceSize ? 1 : numThreads, mode.trace, [&](int t, SymbolReader & input, ostream & out) {
+		Profile* profile = profiling ? &profiles[t] : NULL;
+		ProfileTimer timer(profile ? &profile->caseMillis : NULL);
+		if (profile) { ++profile->cases; }
+		if (pieceSize) {
+			analyzeSplit(dpda, resting, input, out, mode, maxDepth, pieceSize, numThreads, profile);
+		} else {
+			analyzeDPDA(dpda, input, out, mode, maxDepth, profile);
+		}
+		return true;
+	});
+	if (profiling) {
+		for (int t = 1; t < numThreads; ++t) { profiles[0].add(profiles[t]); }
+		writeProfile(profilePath, profiles[0], "dpda", pieceSize ? "split" : "table", numThreads, loadMillis,
+			chrono::duration<double, milli>(chrono::steady_clock::now() - started).count());
 	}
-}
\ No newline at end of file
+	return 0;
+}
+
+} // namespace dpdaEngine
+
+// the stand-alone ./dpda; the automata binary has a main of its own
+#ifndef AUTOMATA_CLI
+int main(int argc, char** argv) {
+	return dpdaEngine::run(argc, argv);
+}
+#endif
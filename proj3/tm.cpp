@@ -7,132 +7,652 @@
 
 
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <fstream>
 #include <iostream>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
+#include "automata.h"
 using namespace std;
 
 
-// check if an item is in a container
-template <typename T>
-bool isInList(const T x, vector<T> l) {
-	return (find(l.begin(), l.end(), x) != l.end());
+namespace tmEngine {
+
+
+// how long a run may go on before it is given up as not halting
+struct StepBudget {
+	unsigned long long maxSteps; // 0 for no limit
+	double seconds;              // wall-clock time per case, 0 for no limit
+};
+
+
+// one entry of the transition table: the state to go to, the byte to write and
+// the direction to move in, or no transition at all when next is NONE
+struct TMMove {
+	enum { NONE = -1 };
+	int next;
+	unsigned char write;
+	bool left;
+};
+
+
+// the Turing Machine with its states interned to integers. tape symbols are
+// single characters, so they are their own byte and a step is one lookup in
+// a table of 256 entries per state
+struct CompiledTM {
+	SymbolTable states;
+	int start, accept, reject;
+	vector<bool> tapeSymbol; // whether each byte is in the tape alphabet
+	FlatArray<TMMove> moves; // move of (state, byte) at state * 256 + byte
+
+	TMMove & move(int state, unsigned char c) { return moves[state * 256 + c]; }
+	const TMMove & move(int state, unsigned char c) const { return moves[state * 256 + c]; }
+};
+
+
+// intern a parsed description and lay its transitions out in a flat table
+void compileTM(CompiledTM & tm, const vector<string> & states, const vector<string> & tapealpha,
+	const map<pair<string, string>, pair<pair<string, string>, string> > & transitions,
+	const string & start, const string & accept, const string & reject) {
+	for (unsigned i = 0; i < states.size(); ++i) { tm.states.intern(states[i]); }
+	tm.start = tm.states.find(start);
+	tm.accept = tm.states.find(accept);
+	tm.reject = tm.states.find(reject);
+	tm.tapeSymbol.assign(256, false);
+	for (unsigned i = 0; i < tapealpha.size(); ++i) { tm.tapeSymbol[(unsigned char)tapealpha[i][0]] = true; }
+
+	TMMove none = { TMMove::NONE, 0, false };
+	tm.moves.assign(tm.states.size() * 256, none);
+	for (map<pair<string, string>, pair<pair<string, string>, string> >::const_iterator it = transitions.begin(); it != transitions.end(); ++it) {
+		TMMove & m = tm.move(tm.states.find(it->first.first), it->first.second[0]);
+		m.next = tm.states.find(it->second.first.first);
+		m.write = it->second.first.second[0];
+		m.left = (it->second.second == "L");
+	}
+}
+
+
+// the tape of a run, one byte per cell. an input symbol that is not a single
+// character is given a byte outside the tape alphabet, which no transition
+// reads, and its name is kept for printing
+struct Tape {
+	vector<unsigned char> cells;
+	vector<string> names;          // name of each byte
+	vector<unsigned char> renamed; // bytes named after a longer symbol
+	size_t end;                    // one past the rightmost non-blank cell, or past cells blanked since
+
+	// bring end back to just past the rightmost non-blank cell
+	void trim() {
+		while (end > 0 && cells[end - 1] == ' ') { --end; }
+	}
+
+	Tape() : names(256) {
+		for (int c = 0; c < 256; ++c) { names[c] = string(1, (char)c); }
+	}
+};
+
+
+// put the next line of the input on the tape. an empty line leaves a single blank
+void readTape(const CompiledTM & tm, SymbolReader & reader, Tape & tape) {
+	for (unsigned i = 0; i < tape.renamed.size(); ++i) { tape.names[tape.renamed[i]] = string(1, (char)tape.renamed[i]); }
+	tape.renamed.clear();
+	tape.cells.clear();
+	vector<bool> used(256, false);
+	vector<pair<size_t, string> > others;
+	string symbol;
+	reader.beginLine();
+	while (reader.next(symbol)) {
+		if (symbol.size() == 1) {
+			tape.cells.push_back(symbol[0]);
+			used[(unsigned char)symbol[0]] = true;
+		} else {
+			others.push_back(make_pair(tape.cells.size(), symbol));
+			tape.cells.push_back(0);
+		}
+	}
+	if (tape.cells.empty()) { tape.cells.push_back(' '); }
+	tape.end = tape.cells.size();
+	tape.trim();
+
+	// hand the other symbols the bytes that are free, from the top down
+	map<string, int> codes;
+	int code = 256;
+	for (unsigned i = 0; i < others.size(); ++i) {
+		if (!codes.count(others[i].second)) {
+			do { --code; } while (code >= 0 && (tm.tapeSymbol[code] || used[code]));
+			if (code < 0) {
+				cout << "Too many distinct input symbols." << endl;
+				exit(1);
+			}
+			codes[others[i].second] = code;
+			tape.names[code] = others[i].second;
+			tape.renamed.push_back(code);
+		}
+		tape.cells[others[i].first] = codes[others[i].second];
+	}
 }
 
 
 // print the configuration of the Turing Machine
-void printConfig(string state, vector<string> &input, unsigned long long i) {
-	unsigned long long rightmost_nonzero_ind = input.size() - 1;
-	while (input[rightmost_nonzero_ind] == " ") { --rightmost_nonzero_ind; }
-	cout << "(";
-	bool isFirstChar = true;
-	for (int j = 0; j < i; ++j) {
-		if (isFirstChar) { isFirstChar = false; } else { cout << ","; }
-		cout << ((j < input.size()) ? input[j] : " ");
-	}
-	cout << ")" << state << "(";
-	isFirstChar = true;
-	for (int j = i; j <= rightmost_nonzero_ind; ++j) {
-		if (isFirstChar) { isFirstChar = false; } else { cout << ","; }
-		cout << input[j];
-	}
-	cout << ")" << endl;
+void printConfig(ostream & out, const CompiledTM & tm, int state, Tape & tape, size_t i) {
+	const vector<unsigned char> & cells = tape.cells;
+	tape.trim();
+	out << "(";
+	for (size_t j = 0; j < i; ++j) {
+		if (j) { out << ","; }
+		out << ((j < cells.size()) ? tape.names[cells[j]] : " ");
+	}
+	out << ")" << tm.states.name(state) << "(";
+	for (size_t j = i; j < tape.end; ++j) {
+		if (j > i) { out << ","; }
+		out << tape.names[cells[j]];
+	}
+	out << ")" << '\n';
+}
+
+
+// a tape that is unbounded in both directions. its cells live in chunks that
+// are added at either end as the head gets there, so growing the tape never
+// moves a cell that is already on it. cell 0 is where the input starts
+class TwoWayTape {
+public:
+	enum { CHUNK_BITS = 12, CHUNK = 1 << CHUNK_BITS };
+
+	long long lo, hi; // the non-blank cells are within [lo, hi), which may be wider than needed
+
+	// start over with the input on cells 0 onwards
+	void load(const Tape & input) {
+		chunks.clear();
+		first = 0;
+		lo = 0;
+		hi = input.end;
+		for (long long i = 0; i < hi; ++i) { chunk(i >> CHUNK_BITS)[i & (CHUNK - 1)] = input.cells[i]; }
+	}
+
+	// the chunk with a given index, added with blank cells if the tape does not reach it yet
+	unsigned char* chunk(long long index) {
+		if (chunks.empty()) { first = index; }
+		while (index < first) {
+			chunks.push_front(vector<unsigned char>(CHUNK, ' '));
+			--first;
+		}
+		while (index >= first + (long long)chunks.size()) { chunks.push_back(vector<unsigned char>(CHUNK, ' ')); }
+		return &chunks[index - first][0];
+	}
+
+	unsigned char at(long long cell) const {
+		long long index = cell >> CHUNK_BITS;
+		if (index < first || index >= first + (long long)chunks.size()) { return ' '; }
+		return chunks[index - first][cell & (CHUNK - 1)];
+	}
+
+	// narrow [lo, hi) down to the non-blank cells
+	void trim() {
+		while (hi > lo && at(hi - 1) == ' ') { --hi; }
+		while (lo < hi && at(lo) == ' ') { ++lo; }
+	}
+
+	size_t chunkCount() const { return chunks.size(); }
+	size_t bytes() const { return chunks.size() * (CHUNK + sizeof(vector<unsigned char>)); }
+
+private:
+	deque<vector<unsigned char> > chunks;
+	long long first; // index of the leftmost chunk
+};
+
+
+// print the configuration of the Turing Machine on a two-way tape. the left part
+// starts at cell 0 like on the one-way tape, or further left if the tape or
+// the head is there
+void printConfig(ostream & out, const CompiledTM & tm, int state, TwoWayTape & tape, const Tape & input, long long i) {
+	tape.trim();
+	long long from = min(0LL, i), to = i;
+	if (tape.lo < tape.hi) {
+		from = min(from, tape.lo);
+		to = tape.hi;
+	}
+	out << "(";
+	for (long long j = from; j < i; ++j) {
+		if (j > from) { out << ","; }
+		out << input.names[tape.at(j)];
+	}
+	out << ")" << tm.states.name(state) << "(";
+	for (long long j = i; j < to; ++j) {
+		if (j > i) { out << ","; }
+		out << input.names[tape.at(j)];
+	}
+	out << ")" << '\n';
+}
+
+
+// print the verdict of a run. a run found to never halt is given the verdict
+// it was found with and the step it was found at
+void printVerdict(ostream & out, const CompiledTM & tm, int state, unsigned long long steps, const OutputMode & mode, const char* detected) {
+	if (detected) { out << detected << " " << steps << '\n'; return; }
+	printVerdict(out, mode, (state == tm.accept) ? "ACCEPT" : (state == tm.reject) ? "REJECT" : "DID NOT HALT", steps);
+}
+
+
+// print the last configuration when tracing, then the verdict
+void printOutcome(ostream & out, const CompiledTM & tm, int state, Tape & tape, size_t tape_head, unsigned long long steps,
+	const OutputMode & mode, Profile* profile, const char* detected = NULL) {
+	if (mode.trace) {
+		ProfileTimer timer(profile ? &profile->outputMillis : NULL);
+		printConfig(out, tm, state, tape, tape_head);
+	}
+	printVerdict(out, tm, state, steps, mode, detected);
+}
+
+
+// add the counters of a finished run to the profile. every step is one lookup,
+// and so is a missing transition the run stopped at
+void profileRun(Profile* profile, unsigned long long steps, unsigned long long lookups, unsigned long long cells) {
+	if (!profile) { return; }
+	profile->steps += steps;
+	profile->lookups += lookups;
+	profile->peakCells = max(profile->peakCells, cells);
+}
+
+
+// spots runs that can never halt. a configuration that comes back exactly means
+// the machine loops. a state that comes back on a new rightmost cell past the
+// input, with the cells it went back over since the last time unchanged but
+// shifted, means it marches right on blank tape forever. both look for the
+// repeat the way Brent's method does: a configuration is kept at every power
+// of two (of steps, or of new rightmost cells) and the ones after it are
+// checked against it. exact repeats are looked for by a hash of the
+// configuration that is updated as cells are written, and confirmed by
+// comparing the whole tape
+class CycleDetector {
+public:
+	CycleDetector(bool loops, bool runaway) : loops(loops), runaway(runaway) {}
+
+	bool enabled() const { return loops || runaway; }
+
+	// start watching a run at its first configuration
+	void start(Tape & tape, int state) {
+		tapeHash = 0;
+		for (size_t i = 0; i < tape.end; ++i) { tapeHash += cellHash(i, tape.cells[i]); }
+		inputEnd = tape.end;
+		power = recordPower = 1;
+		sinceSaved = records = 0;
+		rightmost = lowest = 0;
+		saveLoop(tape, state, 0);
+		awayState = -1;
+	}
+
+	// keep the hash of the tape up to date with a write
+	void wrote(size_t cell, unsigned char before, unsigned char after) {
+		tapeHash += cellHash(cell, after) - cellHash(cell, before);
+	}
+
+	// look at the configuration after a step, returning the verdict if the run never halts
+	const char* check(Tape & tape, int state, size_t head) {
+		if (loops) {
+			if (tapeHash + configHash(state, head) == savedHash && state == savedState && head == savedHead) {
+				tape.trim();
+				if (tape.end == savedCells.size() && equal(savedCells.begin(), savedCells.end(), tape.cells.begin())) { return "LOOPS"; }
+			}
+			if (++sinceSaved == power) {
+				saveLoop(tape, state, head);
+				power *= 2;
+				sinceSaved = 0;
+			}
+		}
+		if (runaway) {
+			if (head < lowest) { lowest = head; }
+			if (head > rightmost) {
+				rightmost = head;
+				if (head >= inputEnd) {
+					// the run since the saved configuration went back no further than lowest
+					if (state == awayState && lowest > 0) {
+						size_t back = awayHead - lowest;
+						if (equal(awayCells.end() - back - 1, awayCells.end(), tape.cells.begin() + (head - back))) {
+							return "RUNS AWAY";
+						}
+					}
+					if (++records == recordPower) {
+						awayState = state;
+						awayHead = lowest = head;
+						awayCells.assign(tape.cells.begin(), tape.cells.begin() + head + 1);
+						recordPower *= 2;
+						records = 0;
+					}
+				}
+			}
+		}
+		return NULL;
+	}
+
+private:
+	bool loops, runaway;
+	unsigned long long tapeHash, savedHash;
+	int savedState;
+	size_t savedHead;
+	vector<unsigned char> savedCells;
+	unsigned long long power, sinceSaved;
+	size_t inputEnd, rightmost, lowest, awayHead;
+	int awayState;
+	vector<unsigned char> awayCells;
+	unsigned long long records, recordPower;
+
+	static unsigned long long mix(unsigned long long x) {
+		x += 0x9e3779b97f4a7c15ULL;
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+		return x ^ (x >> 31);
+	}
+	// blanks add nothing, so the tape growing does not change its hash
+	static unsigned long long cellHash(size_t cell, unsigned char c) {
+		return (c == ' ') ? 0 : mix(((unsigned long long)cell << 8) | c);
+	}
+	static unsigned long long configHash(int state, size_t head) {
+		return mix(((unsigned long long)head << 24) ^ (unsigned long long)state ^ 0x5bd1e995ULL);
+	}
+
+	void saveLoop(Tape & tape, int state, size_t head) {
+		tape.trim();
+		savedHash = tapeHash + configHash(state, head);
+		savedState = state;
+		savedHead = head;
+		savedCells.assign(tape.cells.begin(), tape.cells.begin() + tape.end);
+	}
+};
+
+
+// meat of the TM simulation. how far right the tape has been written is tracked
+// as it happens, so printing a configuration does not have to look for the
+// rightmost non-blank cell from the far end of the tape
+void simTM(ostream & out, const CompiledTM & tm, Tape & tape, const OutputMode & mode, const StepBudget & budget, CycleDetector & detector,
+	Profile* profile) {
+	vector<unsigned char> & cells = tape.cells;
+	int curr_state = tm.start;
+	size_t tape_head = 0, reach = 0;
+	unsigned long long steps = 0;
+	bool stuck = false;
+	bool detecting = detector.enabled();
+	const char* detected = NULL;
+	if (detecting) { detector.start(tape, curr_state); }
+	chrono::steady_clock::time_point deadline = chrono::steady_clock::now() +
+		chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(budget.seconds));
+	while (curr_state != tm.accept && curr_state != tm.reject) {
+		if (budget.maxSteps && steps == budget.maxSteps) { break; }
+		// the clock is only looked at now and then
+		if (budget.seconds && !(steps & 0xffff) && steps && chrono::steady_clock::now() > deadline) { break; }
+		if (mode.trace && mode.traceEvery && steps % mode.traceEvery == 0) {
+			ProfileTimer timer(profile ? &profile->outputMillis : NULL);
+			printConfig(out, tm, curr_state, tape, tape_head);
+		}
+		const TMMove & m = tm.move(curr_state, cells[tape_head]);
+		if (m.next == TMMove::NONE) {
+			curr_state = tm.reject;
+			++tape_head;
+			stuck = true;
+			break;
+		}
+		++steps;
+		curr_state = m.next;
+		if (detecting) { detector.wrote(tape_head, cells[tape_head], m.write); }
+		cells[tape_head] = m.write;
+		if (m.write != ' ' && tape_head >= tape.end) { tape.end = tape_head + 1; }
+		if (m.left) {
+			if (tape_head) { --tape_head; }
+		} else if (++tape_head == cells.size()) {
+			cells.push_back(' ');
+		}
+		if (tape_head > reach) { reach = tape_head; }
+		if (detecting && (detected = detector.check(tape, curr_state, tape_head))) { break; }
+	}
+	profileRun(profile, steps, steps + stuck, reach + 1);
+	printOutcome(out, tm, curr_state, tape, tape_head, steps, mode, profile, detected);
 }
 
 
-// meat of the TM simulation
-void simTM(map<pair<string, string>, pair<pair<string, string>, string> > t,
-	string start, string accept, string reject, vector<string> input) {
-	int MAX_ROUNDS = 1000;
-	string curr_state = start;
-	unsigned long long tape_head = 0;
-	while (curr_state != accept && curr_state != reject && MAX_ROUNDS--) {
-		printConfig(curr_state, input, tape_head);
-		pair<string, string> key = make_pair(curr_state, input[tape_head]);
-		if (!t.count(key)) {
-			curr_state = reject;
+// the same simulation as simTM on a two-way tape, where a left move from the
+// leftmost cell reaches a new one instead of staying put. the head keeps a
+// pointer into its chunk and only looks up another one when it crosses over
+void simTMTwoWay(ostream & out, const CompiledTM & tm, TwoWayTape & tape, const Tape & input, const OutputMode & mode, const StepBudget & budget,
+	Profile* profile) {
+	int curr_state = tm.start;
+	long long tape_head = 0, leftmost = 0, rightmost = 0;
+	bool stuck = false;
+	unsigned char* chunk = tape.chunk(0);
+	int offset = 0;
+	unsigned long long steps = 0;
+	chrono::steady_clock::time_point deadline = chrono::steady_clock::now() +
+		chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(budget.seconds));
+	while (curr_state != tm.accept && curr_state != tm.reject) {
+		if (budget.maxSteps && steps == budget.maxSteps) { break; }
+		if (budget.seconds && !(steps & 0xffff) && steps && chrono::steady_clock::now() > deadline) { break; }
+		if (mode.trace && mode.traceEvery && steps % mode.traceEvery == 0) {
+			ProfileTimer timer(profile ? &profile->outputMillis : NULL);
+			printConfig(out, tm, curr_state, tape, input, tape_head);
+		}
+		const TMMove & m = tm.move(curr_state, chunk[offset]);
+		if (m.next == TMMove::NONE) {
+			curr_state = tm.reject;
 			++tape_head;
+			stuck = true;
 			break;
 		}
-		curr_state = t[key].first.first;
-		input[tape_head] = t[key].first.second;
-		if (t[key].second == "L") {
-			tape_head = (!tape_head) ? 0 : (tape_head - 1);
+		++steps;
+		curr_state = m.next;
+		chunk[offset] = m.write;
+		if (m.write != ' ') {
+			if (tape_head >= tape.hi) { tape.hi = tape_head + 1; }
+			if (tape_head < tape.lo) { tape.lo = tape_head; }
+		}
+		if (m.left) {
+			if (--tape_head < leftmost) { leftmost = tape_head; }
+			if (--offset < 0) {
+				chunk = tape.chunk(tape_head >> TwoWayTape::CHUNK_BITS);
+				offset = TwoWayTape::CHUNK - 1;
+			}
 		} else {
-			++tape_head;
-			if (tape_head == input.size()) {
-				input.push_back(" ");
+			if (++tape_head > rightmost) { rightmost = tape_head; }
+			if (++offset == TwoWayTape::CHUNK) {
+				chunk = tape.chunk(tape_head >> TwoWayTape::CHUNK_BITS);
+				offset = 0;
 			}
 		}
-	}	
-	printConfig(curr_state, input, tape_head);
-	if (curr_state == accept) { cout << "ACCEPT" << endl; }
-	else if (curr_state == reject) { cout << "REJECT" << endl; }
-	else { cout << "DID NOT HALT" << endl; } 
+	}
+	profileRun(profile, steps, steps + stuck, rightmost - leftmost + 1);
+	if (mode.trace) {
+		ProfileTimer timer(profile ? &profile->outputMillis : NULL);
+		printConfig(out, tm, curr_state, tape, input, tape_head);
+	}
+	printVerdict(out, tm, curr_state, steps, mode, NULL);
 }
 
 
-// split a string into tokens by a delimiter and store them in a vector
-vector<string> splitStringByDelimiter(string s, char delim) {
-	vector<string> v;
-	if (!s.size()) { return v; }
-	unsigned long long ind = s.find(delim);
-	while (ind < s.size()) {
-		v.push_back(s.substr(0, ind));
-		s = s.substr(ind + 1);
-		ind = s.find(delim);
+// the effect of running the machine inside one block of tape cells, from some
+// state and head position until the head leaves the block, the machine halts,
+// or the run has gone on inside the block for too long
+struct BlockRun {
+	unsigned long long cells; // the block afterwards, its bytes packed into one word
+	int state;
+	int head;                 // where the head ends up, -1 when it left to the left and width when to the right
+	unsigned long long steps;
+};
+
+
+// the tape seen as blocks of up to 8 cells, with the run across each block
+// cached by state, head position and block contents. a sweep over tape that
+// repeats itself then goes a block per lookup instead of a cell per step. the
+// cache is flushed whenever it reaches its size limit
+class BlockCache {
+public:
+	enum { MAX_STEPS_INSIDE = 1 << 12 };
+
+	unsigned long long hits, misses, flushes, cachedSteps;
+
+	BlockCache(const CompiledTM & tm, int width, size_t maxEntries)
+		: hits(0), misses(0), flushes(0), cachedSteps(0), tm(tm), w(width), maxEntries(maxEntries),
+		  index((size_t)tm.states.size() * width * 2) {}
+
+	// the run starting in a state at a head position within a block. the block
+	// at the left end of the tape keeps the head in place on a left move
+	const BlockRun & run(int state, int head, bool leftEnd, unsigned long long cells) {
+		unordered_map<unsigned long long, int> & entries = index[((size_t)state * w + head) * 2 + leftEnd];
+		unordered_map<unsigned long long, int>::const_iterator it = entries.find(cells);
+		if (it != entries.end()) {
+			++hits;
+			cachedSteps += runs[it->second].steps;
+			return runs[it->second];
+		}
+		++misses;
+		if (runs.size() >= maxEntries) { flush(); }
+		BlockRun r = simulate(state, head, leftEnd, cells);
+		index[((size_t)state * w + head) * 2 + leftEnd][cells] = runs.size();
+		runs.push_back(r);
+		return runs.back();
+	}
+
+	int width() const { return w; }
+	size_t size() const { return runs.size(); }
+
+private:
+	const CompiledTM & tm;
+	int w;
+	size_t maxEntries;
+	vector<unordered_map<unsigned long long, int> > index; // by (state * width + head) * 2 + leftEnd
+	vector<BlockRun> runs;
+
+	BlockRun simulate(int state, int head, bool leftEnd, unsigned long long packed) {
+		unsigned char cells[8];
+		memcpy(cells, &packed, w);
+		BlockRun r = { 0, state, head, 0 };
+		while (r.state != tm.accept && r.state != tm.reject && r.head >= 0 && r.head < w && r.steps < MAX_STEPS_INSIDE) {
+			const TMMove & m = tm.move(r.state, cells[r.head]);
+			if (m.next == TMMove::NONE) {
+				r.state = tm.reject;
+				++r.head;
+				break;
+			}
+			++r.steps;
+			r.state = m.next;
+			cells[r.head] = m.write;
+			if (!m.left) { ++r.head; }
+			else if (r.head || !leftEnd) { --r.head; }
+		}
+		memcpy(&r.cells, cells, w);
+		return r;
 	}
-	v.push_back(s);
-	return v;
+
+	void flush() {
+		++flushes;
+		for (size_t i = 0; i < index.size(); ++i) { index[i].clear(); }
+		runs.clear();
+	}
+};
+
+
+// the same simulation as simTM, but going a block at a time through the block
+// cache. no configurations are printed on the way, only the last one. a lookup
+// is a block run taken from the cache, or a single step, and the head is only
+// seen between block runs, so the cells it went over can be short by a block
+void simTMBlocks(ostream & out, const CompiledTM & tm, BlockCache & cache, Tape & tape, const OutputMode & mode, const StepBudget & budget,
+	Profile* profile) {
+	vector<unsigned char> & cells = tape.cells;
+	size_t width = cache.width();
+	// the tape is kept a whole number of blocks long; the padding is blank
+	cells.resize((cells.size() + width - 1) / width * width, ' ');
+	int curr_state = tm.start;
+	size_t tape_head = 0, reach = 0;
+	unsigned long long steps = 0, rounds = 0, lookups = 0;
+	chrono::steady_clock::time_point deadline = chrono::steady_clock::now() +
+		chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(budget.seconds));
+	while (curr_state != tm.accept && curr_state != tm.reject) {
+		if (budget.maxSteps && steps == budget.maxSteps) { break; }
+		if (budget.seconds && !(++rounds & 0xffff) && chrono::steady_clock::now() > deadline) { break; }
+		size_t block = tape_head - tape_head % width;
+		unsigned long long packed = 0;
+		memcpy(&packed, &cells[block], width);
+		const BlockRun & r = cache.run(curr_state, tape_head - block, block == 0, packed);
+		++lookups;
+
+		// a run that would reach the step limit is taken one step at a time, so
+		// the limit is met before any step that comes after it
+		if (budget.maxSteps && r.steps >= budget.maxSteps - steps) {
+			const TMMove & m = tm.move(curr_state, cells[tape_head]);
+			++lookups;
+			if (m.next == TMMove::NONE) {
+				curr_state = tm.reject;
+				++tape_head;
+				break;
+			}
+			++steps;
+			curr_state = m.next;
+			cells[tape_head] = m.write;
+			if (m.left) {
+				if (tape_head) { --tape_head; }
+			} else if (++tape_head == cells.size()) {
+				cells.resize(cells.size() + width, ' ');
+			}
+			reach = max(reach, tape_head);
+			continue;
+		}
+		memcpy(&cells[block], &r.cells, width);
+		curr_state = r.state;
+		steps += r.steps;
+		tape_head = block + r.head;
+		reach = max(reach, tape_head);
+		if (tape_head == cells.size()) { cells.resize(cells.size() + width, ' '); }
+	}
+	tape.end = cells.size();
+	tape.trim();
+	profileRun(profile, steps, lookups, reach + 1);
+	printOutcome(out, tm, curr_state, tape, tape_head, steps, mode, profile);
 }
 
 
 // check if a transition has valid states, characters, and direction
-bool isTransitionValid(vector<string> t, vector<string> states,
-	vector<string> tapealpha) {
+bool isTransitionValid(const vector<string> & t, const SymbolTable & states,
+	const SymbolTable & tapealpha) {
 	return (t.size() == 5 && 
-		isInList(t[0],    states) && 
-		isInList(t[1], tapealpha) && 
-		isInList(t[2],    states) && 
-		isInList(t[3], tapealpha) &&
+		   states.contains(t[0]) && 
+		tapealpha.contains(t[1]) && 
+		   states.contains(t[2]) && 
+		tapealpha.contains(t[3]) &&
 		(t[4] == "L" || t[4] == "R"));
 }
 
 
-int main(int argc, char** argv) {
-	// check the number of arguments
-	if (argc != 2) {
-		cout << "usage: ./tm <tm_config> < <input_file> > <output_file>" << endl;
-		exit(1);
-    }
+// read a text description, quitting on the first thing wrong with it
+void readDescription(const char* path, vector<string> & states, vector<string> & tapealpha,
+	map<pair<string, string>, pair<pair<string, string>, string> > & transitions, string & start, vector<string> & end) {
 	// check if the input file exists and is readable
-	ifstream inf(argv[1], ios::in);
-	if (!inf) {
-		cout << "Invalid input file: " << argv[1] << "." << endl;
+	DescriptionReader inf(path, DescriptionReader::LINES);
+	if (!inf.good()) {
+		cout << "Invalid input file: " << path << "." << endl;
 		exit(1);
 	}
 
 
     // read the set of states
 	string line;
-	getline(inf, line);
-	if (line[0] != 'Q' || line[1] != ':') {
+	inf.next(line);
+	if (!readSection(line, 'Q', states)) {
 		cout << "Missing description of the set of states." << endl;
 		exit(1);
 	}
-	vector<string> states = splitStringByDelimiter(line.substr(2), ',');
+	SymbolTable stateIds(states);
 
 
 	// read the input alphabet
-	getline(inf, line);
-	if (line[0] != 'A' || line[1] != ':') {
+	vector<string> inputalpha;
+	inf.next(line);
+	if (!readSection(line, 'A', inputalpha)) {
 		cout << "Missing description of the input alphabet." << endl;
 		exit(1);
 	}
-	vector<string> inputalpha = splitStringByDelimiter(line.substr(2), ',');
 	// sort the input alphabet to prepare for the later check of whether the input
 	// alphabet is included in the tape alphabet
 	sort(inputalpha.begin(), inputalpha.end());
@@ -140,7 +660,7 @@ int main(int argc, char** argv) {
 
 	// if the input alphabet contains symbols that are not exactly one character
 	// long or the blank character, then halt
- 	for (int i = 0; i < inputalpha.size(); ++i) {
+ 	for (unsigned i = 0; i < inputalpha.size(); ++i) {
  		if (inputalpha[i].size() != 1) {
  			cout << "Input character must be exactly one character long: " 
  				 << inputalpha[i] << endl;
@@ -153,12 +673,12 @@ int main(int argc, char** argv) {
 	
 
     // read the tape alphabet
-	getline(inf, line);
-	if (line[0] != 'Z' || line[1] != ':') {
+	inf.next(line);
+	if (!readSection(line, 'Z', tapealpha)) {
 		cout << "Missing description of the tape alphabet." << endl;
 		exit(1);
 	}
-	vector<string> tapealpha = splitStringByDelimiter(line.substr(2), ',');
+	SymbolTable tapeIds(tapealpha);
 	// sort the tape alphabet to prepare for the later check of whether the input
 	// alphabet is included in the tape alphabet
 	sort(tapealpha.begin(), tapealpha.end());
@@ -171,7 +691,7 @@ int main(int argc, char** argv) {
 	}
 	// if the tape alphabet contains symbols that are not exactly one character,
 	// then halt
-	for (int i = 0; i < tapealpha.size(); ++i) {
+	for (unsigned i = 0; i < tapealpha.size(); ++i) {
 		if (tapealpha[i].size() != 1) {
 			cout << "Tape character must be exactly one character long: "
 				 << tapealpha[i] << endl;
@@ -187,14 +707,11 @@ int main(int argc, char** argv) {
 
 
 	// read the transition rules
-	map<pair<string, string>, pair<pair<string, string>, string> > transitions;
-	while (getline(inf, line)) {
-		if (line[0] != 'T' || line[1] != ':') { break; }
-		vector<string> transition = splitStringByDelimiter(line.substr(2), ',');
-
+	vector<string> transition;
+	while (inf.next(line) && readSection(line, 'T', transition)) {
 		// if any transition has invalid states, tape characters, or directions,
 		// then halt
-		if (!isTransitionValid(transition, states, tapealpha)) {
+		if (!isTransitionValid(transition, stateIds, tapeIds)) {
 			cout << "Invalid transition: " << line.substr(2) << endl;
 			exit(1);
 		}	
@@ -212,52 +729,425 @@ int main(int argc, char** argv) {
 
 
 	// read the start state
-	if (line[0] != 'S' || line[1] != ':') {
+	if (line.size() < 2 || line[0] != 'S' || line[1] != ':') {
 		cout << "Missing description of the start state." << endl;
 		exit(1);
-	} else if (!isInList(line.substr(2), states)) {
+	} else if (!stateIds.contains(line.substr(2))) {
 		cout << "Invalid start state: " << line.substr(2) << endl;
 		exit(1);
 	}
-	string start = line.substr(2);
+	start = line.substr(2);
 
 
 	// read the final states
-	getline(inf, line);
-	if (line[0] != 'F' || line[1] != ':') {
+	inf.next(line);
+	if (!readSection(line, 'F', end)) {
 		cout << "Missing description of the final states." << endl;
 		exit(1);
 	}
-	vector<string> end = splitStringByDelimiter(line.substr(2), ',');
 	if (end.size() != 2) {
 		cout << "There must be exactly two final states." << endl;
 		exit(1);
 	}
 	// if the final states are the same or any of the final states are not
 	// valid, then halt
-	if (!isInList(end[0], states)) {
+	if (!stateIds.contains(end[0])) {
 		cout << "Invalid accept state: " << end[0] << endl;
 		exit(1);
-	} else if (!isInList(end[1], states)) {
+	} else if (!stateIds.contains(end[1])) {
 		cout << "Invalid reject state: " << end[1] << endl;
 		exit(1);
 	} else if (end[0] == end[1]) {
 		cout << "Accept and reject states must be different." << endl;
 		exit(1);
 	}
+}
+
+
+// write the compiled TM out as an image
+void saveTM(const CompiledTM & tm, const char* path) {
+	ImageWriter image("tm");
+	image.putNames(tm.states);
+	image.put(tm.start);
+	image.put(tm.accept);
+	image.put(tm.reject);
+	image.putFlags(tm.tapeSymbol);
+	image.putArray(tm.moves.begin(), tm.moves.size());
+	image.save(path);
+}
+
+
+// load a compiled TM from an image. the transition table is used where it is
+// in the mapped file
+void loadTM(CompiledTM & tm, ImageReader & image) {
+	image.getNames(tm.states);
+	tm.start = image.get<int>();
+	tm.accept = image.get<int>();
+	tm.reject = image.get<int>();
+	int n = tm.states.size();
+	if (tm.start < 0 || tm.start >= n || tm.accept < 0 || tm.accept >= n || tm.reject < 0 || tm.reject >= n) { image.corrupt(); }
+	tm.tapeSymbol = image.getFlags(256);
+	image.getArray(tm.moves, (size_t)n * 256);
+}
+
+
+// the part of an emitted simulator that does not depend on the machine. it
+// runs on a one-way tape with the same steps, traces and verdicts as simTM
+const char* TM_SIMULATOR = R"SIM(
+// the tape of a run, one byte per cell. an input symbol that is not a single
+// character is given a byte outside the tape alphabet, which no transition
+// reads, and its name is kept for printing
+struct Tape {
+	vector<unsigned char> cells;
+	vector<string> names;          // name of each byte
+	vector<unsigned char> renamed; // bytes named after a longer symbol
+	size_t end;                    // one past the rightmost non-blank cell, or past cells blanked since
+
+	void trim() {
+		while (end > 0 && cells[end - 1] == ' ') { --end; }
+	}
+
+	Tape() : names(256) {
+		for (int c = 0; c < 256; ++c) { names[c] = string(1, (char)c); }
+	}
+};
+
+// put the next line of the input on the tape. an empty line leaves a single blank
+static void readTape(SymbolReader & input, Tape & tape) {
+	for (unsigned i = 0; i < tape.renamed.size(); ++i) { tape.names[tape.renamed[i]] = string(1, (char)tape.renamed[i]); }
+	tape.renamed.clear();
+	tape.cells.clear();
+	vector<bool> used(256, false);
+	for (unsigned i = 0; i < sizeof(TAPE_SYMBOLS) / sizeof(TAPE_SYMBOLS[0]); ++i) { used[TAPE_SYMBOLS[i]] = true; }
+	vector<pair<size_t, string> > others;
+	string symbol;
+	input.beginLine();
+	while (input.next(symbol)) {
+		if (symbol.size() == 1) {
+			tape.cells.push_back(symbol[0]);
+			used[(unsigned char)symbol[0]] = true;
+		} else {
+			others.push_back(make_pair(tape.cells.size(), symbol));
+			tape.cells.push_back(0);
+		}
+	}
+	if (tape.cells.empty()) { tape.cells.push_back(' '); }
+	tape.end = tape.cells.size();
+	tape.trim();
+
+	// hand the other symbols the bytes that are free, from the top down
+	unordered_map<string, int> codes;
+	int code = 256;
+	for (unsigned i = 0; i < others.size(); ++i) {
+		if (!codes.count(others[i].second)) {
+			do { --code; } while (code >= 0 && used[code]);
+			if (code < 0) {
+				cout << "Too many distinct input symbols." << endl;
+				exit(1);
+			}
+			codes[others[i].second] = code;
+			tape.names[code] = others[i].second;
+			tape.renamed.push_back(code);
+		}
+		tape.cells[others[i].first] = codes[others[i].second];
+	}
+}
+
+// print the configuration of the Turing Machine
+static void printConfig(ostream & out, int state, Tape & tape, size_t i) {
+	tape.trim();
+	out << "(";
+	for (size_t j = 0; j < i; ++j) {
+		if (j) { out << ","; }
+		out << ((j < tape.cells.size()) ? tape.names[tape.cells[j]] : " ");
+	}
+	out << ")" << STATES[state] << "(";
+	for (size_t j = i; j < tape.end; ++j) {
+		if (j > i) { out << ","; }
+		out << tape.names[tape.cells[j]];
+	}
+	out << ")" << '\n';
+}
+
+// run a case until it halts or runs out of steps
+static void analyze(SymbolReader & input, ostream & out, const OutputMode & mode, unsigned long long maxSteps, Tape & tape) {
+	readTape(input, tape);
+	vector<unsigned char> & cells = tape.cells;
+	int state = START;
+	size_t head = 0;
+	unsigned long long steps = 0;
+	while (state != ACCEPT && state != REJECT) {
+		if (maxSteps && steps == maxSteps) { break; }
+		if (mode.trace && mode.traceEvery && steps % mode.traceEvery == 0) { printConfig(out, state, tape, head); }
+		int next;
+		unsigned char write;
+		bool left;
+		if (!transition(state, cells[head], next, write, left)) {
+			state = REJECT;
+			++head;
+			break;
+		}
+		++steps;
+		state = next;
+		cells[head] = write;
+		if (write != ' ' && head >= tape.end) { tape.end = head + 1; }
+		if (left) {
+			if (head) { --head; }
+		} else if (++head == cells.size()) {
+			cells.push_back(' ');
+		}
+	}
+	if (mode.trace) { printConfig(out, state, tape, head); }
+	printVerdict(out, mode, (state == ACCEPT) ? "ACCEPT" : (state == REJECT) ? "REJECT" : "DID NOT HALT", steps);
+}
+
+int main(int argc, char** argv) {
+	OutputMode mode = { true, false, 1 };
+	unsigned long long maxSteps = 1000;
+	int numThreads = 1;
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if (arg == "--quiet" || arg == "-q") {
+			mode.trace = false;
+		} else if (arg == "--steps") {
+			mode.stepCount = true;
+		} else if (arg.compare(0, 14, "--trace-every=") == 0) {
+			mode.traceEvery = strtoull(arg.c_str() + 14, NULL, 10);
+		} else if (arg.compare(0, 12, "--max-steps=") == 0) {
+			maxSteps = strtoull(arg.c_str() + 12, NULL, 10);
+		} else if (arg.compare(0, 10, "--threads=") == 0) {
+			numThreads = parseThreadCount(arg.c_str() + 10);
+		} else {
+			cout << "usage: " << argv[0] << " [--quiet] [--steps] [--trace-every=<n>] [--max-steps=<n>] [--threads=<n>] < <input> > <output>" << endl;
+			exit(1);
+		}
+	}
+	bufferOutput();
+	SymbolReader reader(stdin);
+	vector<Tape> tapes(numThreads);
+	runCases(reader, numThreads, mode.trace, [&](int t, SymbolReader & input, ostream & out) {
+		analyze(input, out, mode, maxSteps, tapes[t]);
+		return true;
+	});
+	return 0;
+}
+)SIM";
+
+
+// write a C++ simulator for this Turing Machine alone, with the move of every
+// state on every byte hard-coded as the cases of nested switches
+void emitTM(const CompiledTM & tm, const char* description, const char* path) {
+	ofstream out(path);
+	out << "/* " << path << "\n * The Turing Machine of " << description << " with its transitions compiled in,\n"
+		<< " * written by tm --emit-cpp. It prints what ./tm prints for the same input.\n */\n\n"
+		<< "#include <cstdlib>\n#include <iostream>\n#include <string>\n#include <unordered_map>\n#include <vector>\n#include \"automata.h\"\n"
+		<< "using namespace std;\n\n";
+
+	vector<string> states;
+	for (int i = 0; i < tm.states.size(); ++i) { states.push_back(tm.states.name(i)); }
+	out << "const int START = " << tm.start << ", ACCEPT = " << tm.accept << ", REJECT = " << tm.reject << ";\n\n"
+		<< "// the names of the states, as traces print them\n";
+	emitNames(out, "STATES", states);
+	out << "\n// the bytes of the tape alphabet\nstatic const unsigned char TAPE_SYMBOLS[] = {";
+	for (int c = 0, n = 0; c < 256; ++c) {
+		if (tm.tapeSymbol[c]) { out << (n++ ? ", " : " ") << c; }
+	}
+	out << " };\n";
+
+	out << "\n// the move of a state on a cell: the state to go to, the byte to write and\n"
+		<< "// whether to move left. false when there is none\n"
+		<< "static inline bool transition(int state, unsigned char cell, int & next, unsigned char & write, bool & left) {\n\tswitch (state) {\n";
+	for (int s = 0; s < tm.states.size(); ++s) {
+		bool any = false;
+		for (int c = 0; c < 256; ++c) {
+			const TMMove & m = tm.move(s, c);
+			if (m.next == TMMove::NONE) { continue; }
+			if (!any) { out << "\tcase " << s << ":\n\t\tswitch (cell) {\n"; }
+			any = true;
+			out << "\t\tcase " << c << ": next = " << m.next << "; write = " << (int)m.write << "; left = " << (m.left ? "true" : "false")
+				<< "; return true;\n";
+		}
+		if (any) { out << "\t\t}\n\t\tbreak;\n"; }
+	}
+	out << "\t}\n\treturn false;\n}\n" << TM_SIMULATOR;
+	if (!out) {
+		cout << "Could not write the C++ source: " << path << endl;
+		exit(1);
+	}
+}
+
+
+// print the usage message and quit
+void usage() {
+	cout << "usage: ./tm [--quiet] [--steps] [--trace-every=<n>] [--max-steps=<n>] [--time-limit=<seconds>]"
+		 << " [--two-way] [--threads=<n>] [--macro=<cells>] [--macro-cache=<entries>] [--detect-loops] [--detect-runaway] [--stats] [--profile[=<file>]] [--compile=<image>] [--emit-cpp=<source>] <tm_config|image> < <input_file> > <output_file>" << endl;
+	exit(1);
+}
+
+
+// the TM simulator
+int run(int argc, char** argv) {
+	// read the options and the one and only description file
+	chrono::steady_clock::time_point started = chrono::steady_clock::now();
+	OutputMode mode = { true, false, 1 };
+	StepBudget budget = { 1000, 0 };
+	int blockWidth = 0;
+	size_t blockCacheSize = 1 << 20;
+	bool showStats = false;
+	bool profiling = false;
+	string profilePath;
+	bool detectLoops = false, detectRunaway = false;
+	bool twoWay = false;
+	int numThreads = 1;
+	const char* description = NULL;
+	const char* compileTo = NULL;
+	const char* emitTo = NULL;
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if (arg == "--quiet" || arg == "-q") {
+			mode.trace = false;
+		} else if (arg == "--steps") {
+			mode.stepCount = true;
+		} else if (arg.compare(0, 14, "--trace-every=") == 0) {
+			mode.traceEvery = strtoull(arg.c_str() + 14, NULL, 10);
+		} else if (arg.compare(0, 12, "--max-steps=") == 0) {
+			budget.maxSteps = strtoull(arg.c_str() + 12, NULL, 10);
+		} else if (arg.compare(0, 13, "--time-limit=") == 0) {
+			budget.seconds = strtod(arg.c_str() + 13, NULL);
+		} else if (arg.compare(0, 8, "--macro=") == 0) {
+			blockWidth = atoi(arg.c_str() + 8);
+			if (blockWidth < 0 || blockWidth > 8) { usage(); }
+		} else if (arg.compare(0, 14, "--macro-cache=") == 0) {
+			blockCacheSize = strtoull(arg.c_str() + 14, NULL, 10);
+		} else if (arg.compare(0, 10, "--threads=") == 0) {
+			numThreads = parseThreadCount(arg.c_str() + 10);
+		} else if (arg.compare(0, 10, "--compile=") == 0) {
+			compileTo = argv[i] + 10;
+		} else if (arg.compare(0, 11, "--emit-cpp=") == 0) {
+			emitTo = argv[i] + 11;
+		} else if (arg == "--two-way") {
+			twoWay = true;
+		} else if (arg == "--detect-loops") {
+			detectLoops = true;
+		} else if (arg == "--detect-runaway") {
+			detectRunaway = true;
+		} else if (arg == "--stats") {
+			showStats = true;
+		} else if (arg == "--profile" || arg.compare(0, 10, "--profile=") == 0) {
+			profiling = true;
+			profilePath = (arg.size() > 10) ? arg.substr(10) : "";
+		} else if (arg[0] == '-' || description) {
+			usage();
+		} else {
+			description = argv[i];
+		}
+	}
+	if (!description) { usage(); }
+	if (twoWay && (blockWidth || detectLoops || detectRunaway) && !compileTo && !emitTo) {
+		cout << "The two-way tape runs without macro steps and detectors, use it without --macro, --detect-loops and --detect-runaway." << endl;
+		exit(1);
+	}
 
 
-	// read user input and compute results
-	int numOfCases = 0;
-	cin >> numOfCases;
-	getline(cin, line);
-	bool isFirstCase = true;
-	while (numOfCases--) {
-		if (isFirstCase) { isFirstCase = false; } else { cout << endl; }
-		getline(cin, line);
-		vector<string> input = splitStringByDelimiter(line, ',');
-		// if input line is empty, then initialize the input vector with
-		// a blank character
-		simTM(transitions, start, end[0], end[1], input);
+	// a compiled image is loaded as it is, a text description is read, checked
+	// and interned into its transition table
+	CompiledTM tm;
+	ImageReader image;
+	if (image.open(description, "tm")) {
+		loadTM(tm, image);
+	} else {
+		vector<string> states, tapealpha, end;
+		map<pair<string, string>, pair<pair<string, string>, string> > transitions;
+		string start;
+		readDescription(description, states, tapealpha, transitions, start, end);
+		compileTM(tm, states, tapealpha, transitions, start, end[0], end[1]);
 	}
-}
\ No newline at end of file
+	if (compileTo) {
+		saveTM(tm, compileTo);
+		return 0;
+	}
+	if (emitTo) {
+		emitTM(tm, description, emitTo);
+		return 0;
+	}
+	double loadMillis = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+
+
+	// blocks can only be used on a one-way tape, when the configurations on
+	// the way are neither printed nor watched for repeats. every thread gets
+	// its own tapes, detector and share of the block cache, the compiled
+	// machine itself is shared
+	CycleDetector detector(detectLoops, detectRunaway);
+	bool useBlocks = blockWidth && (!mode.trace || !mode.traceEvery) && !detector.enabled() && !twoWay;
+	vector<Tape> tapes(numThreads);
+	vector<TwoWayTape> twoWayTapes(numThreads);
+	vector<CycleDetector> detectors(numThreads, detector);
+	vector<BlockCache> caches(numThreads, BlockCache(tm, blockWidth ? blockWidth : 1, blockCacheSize / numThreads));
+	vector<size_t> peakChunks(numThreads, 0), peakBytes(numThreads, 0);
+	vector<Profile> profiles(numThreads);
+	auto analyze = [&](int t, SymbolReader & input, ostream & out) {
+		Profile* profile = profiling ? &profiles[t] : NULL;
+		ProfileTimer timer(profile ? &profile->caseMillis : NULL);
+		if (profile) { ++profile->cases; }
+		// the line goes onto the tape symbol by symbol as it is read
+		{
+			ProfileTimer reading(profile ? &profile->inputMillis : NULL);
+			readTape(tm, input, tapes[t]);
+		}
+		if (twoWay) {
+			twoWayTapes[t].load(tapes[t]);
+			simTMTwoWay(out, tm, twoWayTapes[t], tapes[t], mode, budget, profile);
+			peakChunks[t] = max(peakChunks[t], twoWayTapes[t].chunkCount());
+			peakBytes[t] = max(peakBytes[t], twoWayTapes[t].bytes());
+		} else if (useBlocks) {
+			simTMBlocks(out, tm, caches[t], tapes[t], mode, budget, profile);
+		} else {
+			simTM(out, tm, tapes[t], mode, budget, detectors[t], profile);
+		}
+		return true;
+	};
+
+
+	// read user input and compute results, separating traces by blank lines
+	bufferOutput();
+	SymbolReader reader(stdin);
+	runCases(reader, numThreads, mode.trace, analyze);
+
+	if (showStats && twoWay) {
+		cout.flush();
+		cerr << "two-way tape: at most " << *max_element(peakChunks.begin(), peakChunks.end()) << " chunks of "
+			 << (int)TwoWayTape::CHUNK << " cells, " << *max_element(peakBytes.begin(), peakBytes.end()) << " bytes" << endl;
+	}
+	if (showStats && useBlocks) {
+		unsigned long long hits = 0, misses = 0, flushes = 0, cachedSteps = 0;
+		size_t size = 0;
+		for (int t = 0; t < numThreads; ++t) {
+			hits += caches[t].hits;
+			misses += caches[t].misses;
+			flushes += caches[t].flushes;
+			cachedSteps += caches[t].cachedSteps;
+			size += caches[t].size();
+		}
+		cout.flush();
+		cerr << "macro cache: " << size << " entries, " << hits << " hits, " << misses << " misses ("
+			 << (hits + misses ? 100.0 * hits / (hits + misses) : 0.0) << "% hit rate), "
+			 << flushes << " flushes, " << cachedSteps << " steps taken from the cache" << endl;
+	}
+	if (profiling) {
+		for (int t = 1; t < numThreads; ++t) { profiles[0].add(profiles[t]); }
+		writeProfile(profilePath, profiles[0], "tm", twoWay ? "two-way" : useBlocks ? "macro" : "one-way", numThreads, loadMillis,
+			chrono::duration<double, milli>(chrono::steady_clock::now() - started).count());
+	}
+	return 0;
+}
+
+
+} // namespace tmEngine
+
+
+// the stand-alone ./tm; the automata binary has a main of its own
+#ifndef AUTOMATA_CLI
+int main(int argc, char** argv) {
+	return tmEngine::run(argc, argv);
+}
+#endif